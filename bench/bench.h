@@ -0,0 +1,21 @@
+#ifndef BC_BENCH_H
+#define BC_BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+
+static inline double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline void
+bench_report(const char *name, double seconds, double ops, const char *unit)
+{
+	printf("%-32s %10.3f ms %16.2f %s\n", name, seconds * 1e3, ops / seconds,
+		   unit);
+}
+
+#endif
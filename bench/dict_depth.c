@@ -0,0 +1,116 @@
+#include "bench.h"
+#include "dict.h"
+#include "rc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Configuration Knobs */
+
+#define KEY_COUNT 100000
+#define TIMER_SAMPLES 1000
+
+typedef enum bench_order {
+	ORDER_SORTED,
+	ORDER_REVERSE,
+	ORDER_RANDOM,
+} bench_order;
+
+static char g_keys[KEY_COUNT][16];
+static size_t g_key_lens[KEY_COUNT];
+static size_t g_order[KEY_COUNT];
+static double g_latency[KEY_COUNT];
+static uint64_t g_random = UINT64_C(88172645463325252);
+
+static inline uint64_t next_random(void)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+	return g_random;
+}
+
+static int compare_latency(const void *a_ptr, const void *b_ptr)
+{
+	double a = *(const double *)a_ptr;
+	double b = *(const double *)b_ptr;
+	return (a > b) - (a < b);
+}
+
+static void fill_order(bench_order order)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		g_order[i] = order == ORDER_REVERSE ? KEY_COUNT - 1 - i : i;
+	}
+	if (order != ORDER_RANDOM) {
+		return;
+	}
+
+	for (size_t i = KEY_COUNT - 1; i > 0; i--) {
+		size_t j = next_random() % (i + 1);
+		size_t tmp = g_order[i];
+		g_order[i] = g_order[j];
+		g_order[j] = tmp;
+	}
+}
+
+static double get_timer_overhead(void)
+{
+	double total = 0;
+	for (size_t i = 0; i < TIMER_SAMPLES; i++) {
+		double start = bench_now();
+		total += bench_now() - start;
+	}
+	return total / TIMER_SAMPLES;
+}
+
+static void run_order(const char *name, bench_order order)
+{
+	fill_order(order);
+	const bc_dict *dict = NULL;
+	double start = bench_now();
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		size_t key = g_order[i];
+		if (!dict_define(&dict, g_keys[key], g_key_lens[key], NULL)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	double insert = bench_now() - start;
+
+	bc_dict_stats stats;
+	if (!dict_stats(dict, &stats)) {
+		exit(EXIT_FAILURE);
+	}
+
+	double overhead = get_timer_overhead();
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		size_t key = next_random() % KEY_COUNT;
+		start = bench_now();
+		const bc_dict *node = dict_find(dict, g_keys[key], g_key_lens[key]);
+		g_latency[i] = (bench_now() - start - overhead) * 1e9;
+		if (!node) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	qsort(g_latency, KEY_COUNT, sizeof(*g_latency), compare_latency);
+
+	printf("%-8s insert %6.0f ns  depth max %3zu avg %5.1f  lookup p50 %4.0f "
+		   "p90 %4.0f p99 %4.0f p99.9 %5.0f ns\n",
+		   name, insert * 1e9 / KEY_COUNT, stats.max_depth, stats.avg_depth,
+		   g_latency[KEY_COUNT / 2], g_latency[KEY_COUNT * 9 / 10],
+		   g_latency[KEY_COUNT * 99 / 100], g_latency[KEY_COUNT * 999 / 1000]);
+	rc_unref(dict);
+}
+
+int main(void)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		g_key_lens[i] =
+			(size_t)snprintf(g_keys[i], sizeof(g_keys[i]), "id_%08zu", i);
+	}
+
+	run_order("sorted", ORDER_SORTED);
+	run_order("reverse", ORDER_REVERSE);
+	run_order("random", ORDER_RANDOM);
+	return EXIT_SUCCESS;
+}
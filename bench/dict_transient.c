@@ -0,0 +1,67 @@
+#include "bench.h"
+#include "dict.h"
+#include "rc.h"
+
+#include <stdlib.h>
+
+/* Configuration Knobs */
+
+#define KEY_COUNT 100000
+
+static char g_keys[KEY_COUNT][24];
+static size_t g_key_lens[KEY_COUNT];
+
+static const bc_dict *define_each(const bc_dict *dict)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		if (!dict_define(&dict, g_keys[i], g_key_lens[i], NULL)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	return dict;
+}
+
+static const bc_dict *define_transient(const bc_dict *dict)
+{
+	bc_dict_transient trans;
+	dict_transient_init(&trans, dict);
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		if (!dict_transient_define(&trans, g_keys[i], g_key_lens[i], NULL)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	return dict_transient_freeze(&trans);
+}
+
+static const bc_dict *
+run_bench(const char *name, const bc_dict *(*fn)(const bc_dict *),
+		  const bc_dict *dict)
+{
+	double start = bench_now();
+	dict = fn(dict);
+	double seconds = bench_now() - start;
+	bench_report(name, seconds, KEY_COUNT, "keys/s");
+	return dict;
+}
+
+int main(void)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		g_key_lens[i] = (size_t)snprintf(
+			g_keys[i], sizeof(g_keys[i]), "ident_%zu", i * 7919 % KEY_COUNT);
+	}
+
+	const bc_dict *dict = run_bench("dict_define, insert", define_each, NULL);
+	dict = run_bench("dict_define, overwrite", define_each, dict);
+	rc_unref(dict);
+
+	dict = run_bench("transient, insert", define_transient, NULL);
+	dict = run_bench("transient, overwrite", define_transient, dict);
+
+	/* A shared root forces the first edit of each node to copy it */
+	const bc_dict *shared = rc_ref(dict);
+	dict = run_bench("transient, overwrite shared", define_transient, dict);
+	rc_unref(shared);
+	rc_unref(dict);
+	return EXIT_SUCCESS;
+}
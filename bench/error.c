@@ -0,0 +1,113 @@
+#include "bench.h"
+#include "ctx.h"
+#include "error.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "src_file.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <threads.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define DIAG_COUNT 100000
+#define THREAD_COUNT 4
+#define TEXT_LEN 4096
+
+static const bc_src_file *g_file;
+
+static const bc_src_file *create_file(void)
+{
+	char path[] = "/tmp/bc_bench_error_XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	char text[TEXT_LEN];
+	for (size_t i = 0; i < TEXT_LEN; i++) {
+		text[i] = i % 32 == 31 ? '\n' : 'x';
+	}
+	bool ok = write(fd, text, TEXT_LEN) == TEXT_LEN;
+	close(fd);
+
+	const bc_src_file *file = ok ? src_file_load(path) : NULL;
+	unlink(path);
+	return file;
+}
+
+static void emit_range(size_t start, size_t end)
+{
+	const char *at = imm_str_read(src_file_text(g_file));
+	for (size_t i = start; i < end; i++) {
+		bc_ctx ctx;
+		ctx_init(&ctx, g_file, at + (i * 7919) % TEXT_LEN, 1);
+		error_at(
+			BC_ERROR_WARN, &ctx, "unused variable 'x%zu' in function '%s'", i,
+			"main");
+	}
+}
+
+static int run_emitter(void *arg)
+{
+	size_t id = (size_t)arg;
+	size_t chunk = DIAG_COUNT / THREAD_COUNT;
+	emit_range(id * chunk, (id + 1) * chunk);
+	return 0;
+}
+
+static void run_bench(const char *name, bool deferred, size_t thread_count)
+{
+	error_defer(deferred);
+	double start = bench_now();
+	if (thread_count == 1) {
+		emit_range(0, DIAG_COUNT);
+	} else {
+		thrd_t threads[THREAD_COUNT];
+		for (size_t i = 0; i < thread_count; i++) {
+			if (thrd_create(&threads[i], run_emitter, (void *)i) !=
+				thrd_success) {
+				exit(EXIT_FAILURE);
+			}
+		}
+		for (size_t i = 0; i < thread_count; i++) {
+			thrd_join(threads[i], NULL);
+		}
+	}
+	error_flush();
+	double seconds = bench_now() - start;
+	error_defer(false);
+	bench_report(name, seconds, DIAG_COUNT, "diags/s");
+}
+
+int main(void)
+{
+	g_file = create_file();
+	int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	if (!g_file || null_fd < 0) {
+		return EXIT_FAILURE;
+	}
+
+	/* Diagnostics go to /dev/null, results go to stdout */
+	int stderr_fd = dup(STDERR_FILENO);
+	dup2(null_fd, STDERR_FILENO);
+
+	run_bench("text, immediate", false, 1);
+	run_bench("text, deferred", true, 1);
+	run_bench("text, immediate, 4 threads", false, THREAD_COUNT);
+	run_bench("text, deferred, 4 threads", true, THREAD_COUNT);
+
+	error_set_output(BC_ERROR_OUTPUT_JSONL);
+	run_bench("jsonl, deferred", true, 1);
+	error_set_output(BC_ERROR_OUTPUT_SARIF);
+	run_bench("sarif, deferred", true, 1);
+	error_set_output(BC_ERROR_OUTPUT_TEXT);
+
+	dup2(stderr_fd, STDERR_FILENO);
+	close(stderr_fd);
+	close(null_fd);
+	rc_unref(g_file);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "bench.h"
+#include "dict.h"
+#include "hamt.h"
+#include "rc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Configuration Knobs */
+
+#define KEY_COUNT_MAX 1000000
+#define LOOKUP_COUNT 2000000
+
+static char (*g_keys)[24];
+static size_t *g_key_lens;
+static size_t *g_queries;
+static uint64_t g_random = 7;
+
+static inline uint64_t next_random(void)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+	return g_random;
+}
+
+static void run_count(size_t count)
+{
+	for (size_t i = 0; i < LOOKUP_COUNT; i++) {
+		g_queries[i] = next_random() % count;
+	}
+
+	double start = bench_now();
+	const bc_dict *dict = NULL;
+	for (size_t i = 0; i < count; i++) {
+		if (!dict_define(&dict, g_keys[i], g_key_lens[i], NULL)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	double dict_insert = bench_now() - start;
+
+	start = bench_now();
+	const bc_hamt *hamt = NULL;
+	for (size_t i = 0; i < count; i++) {
+		if (!hamt_define(&hamt, g_keys[i], g_key_lens[i], NULL)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	double hamt_insert = bench_now() - start;
+
+	size_t found = 0;
+	start = bench_now();
+	for (size_t i = 0; i < LOOKUP_COUNT; i++) {
+		size_t key = g_queries[i];
+		found += dict_find(dict, g_keys[key], g_key_lens[key]) != NULL;
+	}
+	double dict_lookup = bench_now() - start;
+
+	start = bench_now();
+	for (size_t i = 0; i < LOOKUP_COUNT; i++) {
+		size_t key = g_queries[i];
+		found += hamt_find(hamt, g_keys[key], g_key_lens[key]) != NULL;
+	}
+	double hamt_lookup = bench_now() - start;
+
+	if (found != 2 * LOOKUP_COUNT) {
+		exit(EXIT_FAILURE);
+	}
+	printf("%8zu keys: insert treap %6.0f ns hamt %6.0f ns | "
+		   "lookup treap %5.0f ns hamt %5.0f ns\n",
+		   count, dict_insert * 1e9 / count, hamt_insert * 1e9 / count,
+		   dict_lookup * 1e9 / LOOKUP_COUNT, hamt_lookup * 1e9 / LOOKUP_COUNT);
+	rc_unref(dict);
+	rc_unref(hamt);
+}
+
+int main(void)
+{
+	g_keys = malloc(KEY_COUNT_MAX * sizeof(*g_keys));
+	g_key_lens = malloc(KEY_COUNT_MAX * sizeof(*g_key_lens));
+	g_queries = malloc(LOOKUP_COUNT * sizeof(*g_queries));
+	if (!g_keys || !g_key_lens || !g_queries) {
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < KEY_COUNT_MAX; i++) {
+		g_key_lens[i] = (size_t)snprintf(
+			g_keys[i], sizeof(g_keys[i]), "ident_%x_%zu",
+			(unsigned)(next_random() & 0xfff), i);
+	}
+
+	run_count(1000);
+	run_count(100000);
+	run_count(KEY_COUNT_MAX);
+
+	free(g_keys);
+	free(g_key_lens);
+	free(g_queries);
+	return EXIT_SUCCESS;
+}
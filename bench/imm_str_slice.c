@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "dict.h"
+#include "imm_str.h"
+#include "rc.h"
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Configuration Knobs */
+
+#define SLICE_COUNT 10000000
+#define KEY_COUNT 1000000
+#define LOOKUP_COUNT 2000000
+
+static char (*g_keys)[40];
+static size_t *g_key_lens;
+static uint64_t g_random = 11;
+
+static inline uint64_t next_random(void)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+	return g_random;
+}
+
+static size_t get_heap_used(void)
+{
+	return mallinfo2().uordblks;
+}
+
+/* Slices of up to BC_IMM_STR_SLICE_SMALL_MAX bytes are copied inline and
+ * drop their string, longer ones keep a reference to it */
+static void run_slices(const bc_imm_str *str, size_t len)
+{
+	bc_imm_str_slice slice;
+	imm_str_slice_init(&slice, NULL, NULL, 0);
+	size_t total = 0;
+	double start = bench_now();
+	for (size_t i = 0; i < SLICE_COUNT; i++) {
+		imm_str_slice_reinit(&slice, rc_ref(str), imm_str_read(str), len);
+		total += (unsigned char)imm_str_slice_read(&slice)[len - 1];
+	}
+	double seconds = bench_now() - start;
+	imm_str_slice_clear(&slice);
+	if (!total) {
+		exit(EXIT_FAILURE);
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "slice %zu bytes", len);
+	bench_report(name, seconds, SLICE_COUNT, "slices/s");
+}
+
+/* Short identifiers stay inline in the dict node, long ones are interned.
+ * The dict is returned live so the next run cannot reuse its slabs. */
+static const bc_dict *run_keys(const char *prefix)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		g_key_lens[i] = (size_t)snprintf(
+			g_keys[i], sizeof(g_keys[i]), "%s%zx", prefix, i);
+	}
+
+	size_t before = get_heap_used();
+	double start = bench_now();
+	const bc_dict *dict = NULL;
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		if (!dict_define(&dict, g_keys[i], g_key_lens[i], NULL)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	double insert = bench_now() - start;
+	size_t heap = get_heap_used() - before;
+
+	size_t found = 0;
+	start = bench_now();
+	for (size_t i = 0; i < LOOKUP_COUNT; i++) {
+		size_t key = next_random() % KEY_COUNT;
+		found += dict_find(dict, g_keys[key], g_key_lens[key]) != NULL;
+	}
+	double lookup = bench_now() - start;
+	if (found != LOOKUP_COUNT) {
+		exit(EXIT_FAILURE);
+	}
+
+	printf("%2zu-byte keys: insert %6.0f ns lookup %6.0f ns heap %6.1f MiB\n",
+		   g_key_lens[KEY_COUNT - 1], insert * 1e9 / KEY_COUNT,
+		   lookup * 1e9 / LOOKUP_COUNT, heap / 1048576.0);
+	return dict;
+}
+
+int main(void)
+{
+	g_keys = malloc(KEY_COUNT * sizeof(*g_keys));
+	g_key_lens = malloc(KEY_COUNT * sizeof(*g_key_lens));
+	const bc_imm_str *str = imm_str_create("a source line that is long enough");
+	if (!g_keys || !g_key_lens || !str) {
+		return EXIT_FAILURE;
+	}
+
+	run_slices(str, 8);
+	run_slices(str, BC_IMM_STR_SLICE_SMALL_MAX);
+	run_slices(str, BC_IMM_STR_SLICE_SMALL_MAX + 1);
+	run_slices(str, 32);
+	const bc_dict *short_keys = run_keys("id_");
+	const bc_dict *long_keys = run_keys("long_identifier_name_");
+
+	rc_unref(short_keys);
+	rc_unref(long_keys);
+	rc_unref(str);
+	free(g_keys);
+	free(g_key_lens);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include "bench.h"
+#include "dict.h"
+#include "rc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <threads.h>
+
+/* Configuration Knobs */
+
+#define KEY_COUNT 20000
+#define ROUND_COUNT 10
+#define REF_COUNT 10000000
+
+static char g_keys[KEY_COUNT][16];
+static size_t g_key_lens[KEY_COUNT];
+
+static const bc_dict *build_dict(void)
+{
+	const bc_dict *dict = NULL;
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		if (!dict_define(&dict, g_keys[i], g_key_lens[i], NULL)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	return dict;
+}
+
+/* Objects built by a finished thread only have the shared atomic count */
+static int run_builder(void *dest_ptr)
+{
+	const bc_dict **dest = dest_ptr;
+	*dest = build_dict();
+	return 0;
+}
+
+static const bc_dict *build_foreign_dict(void)
+{
+	const bc_dict *dict = NULL;
+	thrd_t thread;
+	if (thrd_create(&thread, run_builder, &dict) != thrd_success) {
+		exit(EXIT_FAILURE);
+	}
+	thrd_join(thread, NULL);
+	return dict;
+}
+
+static void churn_dict(const char *name, const bc_dict *dict)
+{
+	double start = bench_now();
+	for (size_t round = 0; round < ROUND_COUNT; round++) {
+		for (size_t i = 0; i < KEY_COUNT; i++) {
+			dict_delete(&dict, g_keys[i], g_key_lens[i]);
+			if (!dict_define(&dict, g_keys[i], g_key_lens[i], NULL)) {
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	double seconds = bench_now() - start;
+	bench_report(name, seconds, 2.0 * KEY_COUNT * ROUND_COUNT, "ops/s");
+	rc_unref(dict);
+}
+
+static void churn_refs(const char *name, const void *ptr)
+{
+	double start = bench_now();
+	for (size_t i = 0; i < REF_COUNT; i++) {
+		rc_unref(rc_ref(ptr));
+	}
+	double seconds = bench_now() - start;
+	bench_report(name, seconds, REF_COUNT, "pairs/s");
+}
+
+static int run_alloc(void *dest_ptr)
+{
+	*(void **)dest_ptr = rc_alloc(sizeof(uint64_t), NULL);
+	return 0;
+}
+
+int main(void)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		g_key_lens[i] = (size_t)snprintf(
+			g_keys[i], sizeof(g_keys[i]), "ident_%zu", i * 7919 % KEY_COUNT);
+	}
+
+	churn_dict("dict churn, owner thread", build_dict());
+	churn_dict("dict churn, foreign nodes", build_foreign_dict());
+
+	void *owned = rc_alloc(sizeof(uint64_t), NULL);
+	void *foreign = NULL;
+	thrd_t thread;
+	if (!owned || thrd_create(&thread, run_alloc, &foreign) != thrd_success) {
+		return EXIT_FAILURE;
+	}
+	thrd_join(thread, NULL);
+
+	churn_refs("rc_ref/rc_unref, owner", owned);
+	churn_refs("rc_ref/rc_unref, shared", foreign);
+	rc_unref(owned);
+	rc_unref(foreign);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+#include "bench.h"
+#include "rc.h"
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define OBJECT_COUNT 100000
+
+static const size_t g_sizes[] = {8, 16, 24, 40, 64, 100, 256, 480, 1024};
+
+#define SIZE_COUNT (sizeof(g_sizes) / sizeof(*g_sizes))
+
+static void *g_objects[SIZE_COUNT][OBJECT_COUNT];
+
+static size_t get_heap_used(void)
+{
+	return mallinfo2().uordblks;
+}
+
+/* Objects stay live until every size is measured, so no size class reuses
+ * blocks freed by a previous one */
+static void alloc_size(size_t index)
+{
+	size_t size = g_sizes[index];
+	size_t before = get_heap_used();
+	double start = bench_now();
+	for (size_t i = 0; i < OBJECT_COUNT; i++) {
+		void *object = rc_alloc(size, NULL);
+		if (!object || rc_size(object) != size) {
+			fprintf(stderr, "rc_alloc(%zu) failed\n", size);
+			exit(EXIT_FAILURE);
+		}
+		memset(object, 0, size);
+		g_objects[index][i] = object;
+	}
+	double seconds = bench_now() - start;
+	double used = (double)(get_heap_used() - before) / OBJECT_COUNT;
+
+	printf("size %4zu: %8.2f bytes/object %6.2f overhead %7.2f ns/alloc\n",
+		   size, used, used - (double)size, seconds * 1e9 / OBJECT_COUNT);
+}
+
+static void free_size(size_t index)
+{
+	double start = bench_now();
+	for (size_t i = 0; i < OBJECT_COUNT; i++) {
+		rc_unref(g_objects[index][i]);
+	}
+	double seconds = bench_now() - start;
+
+	printf("size %4zu: %7.2f ns/free\n", g_sizes[index],
+		   seconds * 1e9 / OBJECT_COUNT);
+}
+
+int main(void)
+{
+	printf("rc footprint, compact header %s\n",
+		   BC_RC_COMPACT_HEADER ? "on" : "off");
+	for (size_t i = 0; i < SIZE_COUNT; i++) {
+		alloc_size(i);
+	}
+	for (size_t i = 0; i < SIZE_COUNT; i++) {
+		free_size(i);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include "bench.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "rope.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define PIECE_COUNT_MAX 16000
+
+static const bc_imm_str *g_pieces[PIECE_COUNT_MAX];
+
+/* Naive baseline: copy everything built so far for every piece */
+static size_t concat_copy(size_t count)
+{
+	const bc_imm_str *str = imm_str_create_n("", 0);
+	for (size_t i = 0; str && i < count; i++) {
+		size_t len = imm_str_len(str);
+		size_t piece_len = imm_str_len(g_pieces[i]);
+		bc_imm_str *next = imm_str_alloc(len + piece_len);
+		if (next) {
+			char *dest = imm_str_write(next);
+			memcpy(dest, imm_str_read(str), len);
+			memcpy(dest + len, imm_str_read(g_pieces[i]), piece_len);
+		}
+		rc_unref(str);
+		str = next;
+	}
+
+	size_t len = str ? imm_str_len(str) : 0;
+	rc_unref(str);
+	return len;
+}
+
+static size_t concat_resize(size_t count)
+{
+	bc_imm_str *str = imm_str_alloc(0);
+	size_t len = 0;
+	for (size_t i = 0; str && i < count; i++) {
+		size_t piece_len = imm_str_len(g_pieces[i]);
+		str = imm_str_resize(str, len + piece_len);
+		if (str) {
+			memcpy(
+				imm_str_write(str) + len, imm_str_read(g_pieces[i]), piece_len);
+			len += piece_len;
+		}
+	}
+	rc_unref(str);
+	return len;
+}
+
+static const bc_rope *concat_rope(size_t count)
+{
+	const bc_rope *rope = NULL;
+	for (size_t i = 0; i < count; i++) {
+		rope = rope_concat(rope, rope_from_str(rc_ref(g_pieces[i])));
+	}
+	return rope;
+}
+
+static void run_count(size_t count, int null_fd)
+{
+	size_t total = 0;
+	for (size_t i = 0; i < count; i++) {
+		total += imm_str_len(g_pieces[i]);
+	}
+
+	double start = bench_now();
+	size_t copy_len = concat_copy(count);
+	double copy = bench_now() - start;
+
+	start = bench_now();
+	size_t resize_len = concat_resize(count);
+	double resize = bench_now() - start;
+
+	start = bench_now();
+	const bc_rope *rope = concat_rope(count);
+	double build = bench_now() - start;
+
+	start = bench_now();
+	const bc_imm_str *flat = rope_flatten(rope);
+	double flatten = bench_now() - start;
+
+	start = bench_now();
+	bool written = rope_write_fd(rope, null_fd);
+	double write = bench_now() - start;
+
+	if (copy_len != total || resize_len != total || !flat ||
+		imm_str_len(flat) != total || !written) {
+		exit(EXIT_FAILURE);
+	}
+	printf("%6zu pieces (%7zu B): copy %8.3f ms resize %8.3f ms | "
+		   "rope build %7.3f ms flatten %6.3f ms writev %6.3f ms\n",
+		   count, total, copy * 1e3, resize * 1e3, build * 1e3, flatten * 1e3,
+		   write * 1e3);
+	rc_unref(flat);
+	rc_unref(rope);
+}
+
+int main(void)
+{
+	for (size_t i = 0; i < PIECE_COUNT_MAX; i++) {
+		char buf[64];
+		int len =
+			snprintf(buf, sizeof(buf), "warning: piece %zu of output\n", i);
+		g_pieces[i] = imm_str_create_n(buf, (size_t)len);
+		if (!g_pieces[i]) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	if (null_fd < 0) {
+		return EXIT_FAILURE;
+	}
+
+	for (size_t count = 1000; count <= PIECE_COUNT_MAX; count *= 2) {
+		run_count(count, null_fd);
+	}
+
+	close(null_fd);
+	for (size_t i = 0; i < PIECE_COUNT_MAX; i++) {
+		rc_unref(g_pieces[i]);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+#include "bench.h"
+#include "scan.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define BUFFER_SIZE (16 << 20)
+#define PASS_COUNT 16
+
+static char g_text[BUFFER_SIZE];
+static char g_ident[BUFFER_SIZE];
+static size_t g_lines[BUFFER_SIZE / 2];
+static volatile size_t g_sink;
+
+/* Source-like text with short lines and no quotes or backslashes */
+static void fill_buffers(void)
+{
+	static const char words[] = "static inline size_t count = at[i] + 1;";
+	unsigned state = 1;
+	for (size_t i = 0; i < BUFFER_SIZE; i++) {
+		state = state * 1103515245 + 12345;
+		unsigned pick = state >> 16;
+		g_text[i] = pick % 40 ? words[pick % (sizeof(words) - 1)] : '\n';
+		g_ident[i] = "abcdefghijklmnopqrstuvwxyz_0123456789"[pick % 37];
+	}
+}
+
+/* Scalar Baselines */
+
+static const char *find_any_naive(
+	const char *at, const char *end, const char *set, size_t set_len)
+{
+	for (; at < end; at++) {
+		if (memchr(set, *at, set_len)) {
+			break;
+		}
+	}
+	return at;
+}
+
+static const char *skip_ident_naive(const char *at, const char *end)
+{
+	while (at < end && (*at == '_' || (*at >= '0' && *at <= '9') ||
+						(*at >= 'a' && *at <= 'z') ||
+						(*at >= 'A' && *at <= 'Z'))) {
+		at++;
+	}
+	return at;
+}
+
+static size_t count_newlines_naive(const char *at, const char *end)
+{
+	size_t count = 0;
+	for (; at < end; at++) {
+		if (*at == '\n') {
+			count++;
+		}
+	}
+	return count;
+}
+
+/* Benchmarks */
+
+typedef enum bench_kind {
+	BENCH_FIND_BYTE,
+	BENCH_FIND_ANY,
+	BENCH_FIND_ANY_NAIVE,
+	BENCH_SKIP_IDENT,
+	BENCH_SKIP_IDENT_NAIVE,
+	BENCH_COUNT_NEWLINES,
+	BENCH_COUNT_NEWLINES_NAIVE,
+	BENCH_INDEX_NEWLINES,
+} bench_kind;
+
+static size_t run_pass(bench_kind kind)
+{
+	static const char set[] = "\"'\\";
+	const char *text_end = g_text + BUFFER_SIZE;
+	const char *ident_end = g_ident + BUFFER_SIZE;
+	switch (kind) {
+	case BENCH_FIND_BYTE:
+		return (size_t)(scan_find_byte(g_text, text_end, '"') - g_text);
+	case BENCH_FIND_ANY:
+		return (size_t)(
+			scan_find_any(g_text, text_end, set, sizeof(set) - 1) - g_text);
+	case BENCH_FIND_ANY_NAIVE:
+		return (size_t)(
+			find_any_naive(g_text, text_end, set, sizeof(set) - 1) - g_text);
+	case BENCH_SKIP_IDENT:
+		return (size_t)(scan_skip_ident(g_ident, ident_end) - g_ident);
+	case BENCH_SKIP_IDENT_NAIVE:
+		return (size_t)(skip_ident_naive(g_ident, ident_end) - g_ident);
+	case BENCH_COUNT_NEWLINES:
+		return scan_count_newlines(g_text, text_end);
+	case BENCH_COUNT_NEWLINES_NAIVE:
+		return count_newlines_naive(g_text, text_end);
+	case BENCH_INDEX_NEWLINES:
+		return scan_index_newlines(g_text, text_end, g_lines);
+	}
+	return 0;
+}
+
+static void run_bench(const char *name, bench_kind kind, size_t expect)
+{
+	size_t result = run_pass(kind);
+	if (result != expect) {
+		fprintf(stderr, "%s: got %zu, expected %zu\n", name, result, expect);
+		exit(EXIT_FAILURE);
+	}
+
+	double start = bench_now();
+	for (size_t i = 0; i < PASS_COUNT; i++) {
+		g_sink += run_pass(kind);
+	}
+	double seconds = bench_now() - start;
+	bench_report(name, seconds, (double)BUFFER_SIZE * PASS_COUNT / 1e9, "GB/s");
+}
+
+int main(void)
+{
+	fill_buffers();
+	size_t newlines = count_newlines_naive(g_text, g_text + BUFFER_SIZE);
+
+	run_bench("scan_find_byte", BENCH_FIND_BYTE, BUFFER_SIZE);
+	run_bench("scan_find_any", BENCH_FIND_ANY, BUFFER_SIZE);
+	run_bench("find_any (naive)", BENCH_FIND_ANY_NAIVE, BUFFER_SIZE);
+	run_bench("scan_skip_ident", BENCH_SKIP_IDENT, BUFFER_SIZE);
+	run_bench("skip_ident (naive)", BENCH_SKIP_IDENT_NAIVE, BUFFER_SIZE);
+	run_bench("scan_count_newlines", BENCH_COUNT_NEWLINES, newlines);
+	run_bench(
+		"count_newlines (naive)", BENCH_COUNT_NEWLINES_NAIVE, newlines);
+	run_bench("scan_index_newlines", BENCH_INDEX_NEWLINES, newlines);
+	return EXIT_SUCCESS;
+}
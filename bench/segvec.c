@@ -0,0 +1,75 @@
+#include "bench.h"
+#include "segvec.h"
+#include "vec.h"
+
+#include <stdlib.h>
+
+/* Configuration Knobs */
+
+#define TOKEN_COUNT 20000000
+#define BATCH_LEN 64
+
+typedef struct {
+	size_t start;
+	size_t end;
+} token;
+
+BC_VEC_IMPLEMENT(token_vec, token)
+BC_SEGVEC_IMPLEMENT(token_segvec, token)
+
+static token g_batch[BATCH_LEN];
+
+/* Token streams of unknown length, pushed one at a time or in batches */
+static void run_vec(void)
+{
+	double start = bench_now();
+	token_vec *vec = token_vec_create(0);
+	for (size_t i = 0; i < TOKEN_COUNT; i++) {
+		if (token_vec_push(&vec, (token){i, i + 1})) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	bench_report("vec push", bench_now() - start, TOKEN_COUNT, "tokens/s");
+	token_vec_destroy(vec);
+
+	start = bench_now();
+	vec = token_vec_create(0);
+	for (size_t i = 0; i < TOKEN_COUNT / BATCH_LEN; i++) {
+		if (token_vec_append(&vec, g_batch, BATCH_LEN)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	bench_report("vec append", bench_now() - start, TOKEN_COUNT, "tokens/s");
+	token_vec_destroy(vec);
+}
+
+static void run_segvec(void)
+{
+	double start = bench_now();
+	token_segvec *vec = token_segvec_create();
+	for (size_t i = 0; i < TOKEN_COUNT; i++) {
+		if (!vec || token_segvec_push(vec, (token){i, i + 1})) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	bench_report("segvec push", bench_now() - start, TOKEN_COUNT, "tokens/s");
+	token_segvec_destroy(vec);
+
+	start = bench_now();
+	vec = token_segvec_create();
+	for (size_t i = 0; i < TOKEN_COUNT / BATCH_LEN; i++) {
+		if (!vec || token_segvec_append(vec, g_batch, BATCH_LEN)) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	bench_report(
+		"segvec append", bench_now() - start, TOKEN_COUNT, "tokens/s");
+	token_segvec_destroy(vec);
+}
+
+int main(void)
+{
+	run_vec();
+	run_segvec();
+	return EXIT_SUCCESS;
+}
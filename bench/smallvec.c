@@ -0,0 +1,69 @@
+#include "bench.h"
+#include "vec.h"
+
+#include <stdlib.h>
+
+/* Configuration Knobs */
+
+#define INLINE_CAP 4
+#define LIST_COUNT 10000000
+#define LIST_LEN_MAX 8
+
+BC_VEC_IMPLEMENT(heap_vec, size_t)
+BC_SMALLVEC_IMPLEMENT(small_vec, size_t, INLINE_CAP)
+
+static volatile size_t g_sink;
+
+/* Short-lived lists of 0..max elements, as built for call arguments */
+static double run_heap(size_t max)
+{
+	size_t sum = 0;
+	double start = bench_now();
+	for (size_t i = 0; i < LIST_COUNT; i++) {
+		heap_vec *vec = heap_vec_create(0);
+		for (size_t k = 0; k < i % (max + 1); k++) {
+			if (heap_vec_push(&vec, k)) {
+				exit(EXIT_FAILURE);
+			}
+		}
+		for (size_t k = 0; k < vec->len; k++) {
+			sum += vec->elem[k];
+		}
+		heap_vec_destroy(vec);
+	}
+	g_sink = sum;
+	return bench_now() - start;
+}
+
+static double run_small(size_t max)
+{
+	size_t sum = 0;
+	double start = bench_now();
+	for (size_t i = 0; i < LIST_COUNT; i++) {
+		small_vec vec;
+		small_vec_init(&vec);
+		for (size_t k = 0; k < i % (max + 1); k++) {
+			if (small_vec_push(&vec, k)) {
+				exit(EXIT_FAILURE);
+			}
+		}
+		size_t *elem = small_vec_elem(&vec);
+		for (size_t k = 0; k < vec.len; k++) {
+			sum += elem[k];
+		}
+		small_vec_destroy(&vec);
+	}
+	g_sink = sum;
+	return bench_now() - start;
+}
+
+int main(void)
+{
+	for (size_t max = 1; max <= LIST_LEN_MAX; max *= 2) {
+		double heap = run_heap(max);
+		double small = run_small(max);
+		printf("0..%zu elements: vec %6.1f ns/list smallvec %6.1f ns/list\n",
+			   max, heap * 1e9 / LIST_COUNT, small * 1e9 / LIST_COUNT);
+	}
+	return EXIT_SUCCESS;
+}
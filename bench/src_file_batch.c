@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "scan.h"
+#include "src_file.h"
+#include "tree.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define FILE_COUNT 1000
+#define FILE_LEN_MIN 512
+#define FILE_LEN_MAX (64 << 10)
+
+static bench_tree g_tree;
+static bool g_seen[FILE_COUNT];
+static size_t g_lines;
+
+/* Drops the tree from the page cache, pages are clean so this is honoured */
+static void evict_tree(void)
+{
+	for (size_t i = 0; i < g_tree.count; i++) {
+		int fd = open(g_tree.paths[i], O_RDONLY | O_CLOEXEC);
+		if (fd >= 0) {
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			close(fd);
+		}
+	}
+}
+
+static void lex_file(const bc_src_file *file)
+{
+	const bc_imm_str *text = src_file_text(file);
+	const char *at = imm_str_read(text);
+	g_lines += scan_count_newlines(at, at + imm_str_len(text));
+}
+
+static void on_loaded(void *arg, size_t index, const bc_src_file *file)
+{
+	(void)arg;
+	if (!file || g_seen[index]) {
+		exit(EXIT_FAILURE);
+	}
+	g_seen[index] = true;
+	lex_file(file);
+	rc_unref(file);
+}
+
+static double load_sequential(bool cold)
+{
+	src_file_cache_trim();
+	if (cold) {
+		evict_tree();
+	}
+
+	double start = bench_now();
+	for (size_t i = 0; i < g_tree.count; i++) {
+		const bc_src_file *file = src_file_load(g_tree.paths[i]);
+		if (!file) {
+			exit(EXIT_FAILURE);
+		}
+		lex_file(file);
+		rc_unref(file);
+	}
+	return bench_now() - start;
+}
+
+static double load_batch(bool cold)
+{
+	src_file_cache_trim();
+	if (cold) {
+		evict_tree();
+	}
+
+	for (size_t i = 0; i < g_tree.count; i++) {
+		g_seen[i] = false;
+	}
+	double start = bench_now();
+	if (!src_file_load_many(
+			(const char *const *)g_tree.paths, g_tree.count, on_loaded,
+			NULL)) {
+		exit(EXIT_FAILURE);
+	}
+	return bench_now() - start;
+}
+
+int main(void)
+{
+	if (!bench_tree_create(&g_tree, FILE_COUNT, FILE_LEN_MIN, FILE_LEN_MAX)) {
+		bench_tree_destroy(&g_tree);
+		return EXIT_FAILURE;
+	}
+	printf("%zu files, %zu bytes\n", g_tree.count, g_tree.total);
+
+	for (int cold = 1; cold >= 0; cold--) {
+		g_lines = 0;
+		double sequential = load_sequential(cold);
+		size_t lines = g_lines;
+
+		g_lines = 0;
+		double batch = load_batch(cold);
+		if (lines != g_lines) {
+			return EXIT_FAILURE;
+		}
+		printf("%s cache: sequential %8.3f ms  src_file_load_many %8.3f ms\n",
+			   cold ? "cold" : "warm", sequential * 1e3, batch * 1e3);
+	}
+
+	src_file_cache_trim();
+	bench_tree_destroy(&g_tree);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "scan.h"
+#include "src_file.h"
+#include "tree.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define FILE_COUNT 400
+#define FILE_LEN_MIN 1024
+#define FILE_LEN_MAX (256 << 10)
+
+static const bc_src_file *g_files[FILE_COUNT];
+static char *g_copies[FILE_COUNT];
+static size_t g_copy_lens[FILE_COUNT];
+
+/* Private resident memory in KiB, file-backed mapped pages are shared */
+static long get_private_rss(void)
+{
+	FILE *f = fopen("/proc/self/statm", "r");
+	long size = 0, resident = 0, shared = 0;
+	if (f) {
+		if (fscanf(f, "%ld %ld %ld", &size, &resident, &shared) != 3) {
+			resident = shared = 0;
+		}
+		fclose(f);
+	}
+	return (resident - shared) * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static char *read_copy(const char *path, size_t *len_dest)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	off_t len = lseek(fd, 0, SEEK_END);
+	char *data = len >= 0 ? malloc((size_t)len + 1) : NULL;
+	if (data && pread(fd, data, (size_t)len, 0) != (ssize_t)len) {
+		free(data);
+		data = NULL;
+	}
+	close(fd);
+
+	*len_dest = (size_t)len;
+	return data;
+}
+
+static void report(const char *name, double load, double scan, long rss)
+{
+	printf("%-16s load %8.3f ms  scan %8.3f ms  private rss %+7ld KiB\n",
+		   name, load * 1e3, scan * 1e3, rss);
+}
+
+int main(void)
+{
+	bench_tree tree;
+	if (!bench_tree_create(&tree, FILE_COUNT, FILE_LEN_MIN, FILE_LEN_MAX)) {
+		bench_tree_destroy(&tree);
+		return EXIT_FAILURE;
+	}
+	printf("%zu files, %zu bytes\n", tree.count, tree.total);
+
+	long rss = get_private_rss();
+	double start = bench_now();
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		g_copies[i] = read_copy(tree.paths[i], &g_copy_lens[i]);
+		if (!g_copies[i]) {
+			return EXIT_FAILURE;
+		}
+	}
+	double load = bench_now() - start;
+
+	size_t lines = 0;
+	start = bench_now();
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		lines += scan_count_newlines(g_copies[i], g_copies[i] + g_copy_lens[i]);
+	}
+	report("read copies", load, bench_now() - start, get_private_rss() - rss);
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		free(g_copies[i]);
+	}
+
+	rss = get_private_rss();
+	start = bench_now();
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		g_files[i] = src_file_load(tree.paths[i]);
+		if (!g_files[i]) {
+			return EXIT_FAILURE;
+		}
+	}
+	load = bench_now() - start;
+
+	size_t file_lines = 0;
+	start = bench_now();
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		const bc_imm_str *text = src_file_text(g_files[i]);
+		const char *at = imm_str_read(text);
+		file_lines += scan_count_newlines(at, at + imm_str_len(text));
+	}
+	report("src_file_load", load, bench_now() - start, get_private_rss() - rss);
+
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		rc_unref(g_files[i]);
+	}
+	src_file_cache_trim();
+	bench_tree_destroy(&tree);
+	return lines == file_lines ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,153 @@
+#include "bench.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "scan.h"
+#include "src_file.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define TEXT_LEN (64 << 20)
+#define WRITE_LEN (64 << 10)
+#define PASS_COUNT 4
+
+static char *g_text;
+static char g_dir[] = "/tmp/bc_bench_stream_XXXXXX";
+static char g_file_path[sizeof(g_dir) + 8];
+static char g_fifo_path[sizeof(g_dir) + 8];
+
+static void make_text(void)
+{
+	static const char line[] = "let value = \"caf\xc3\xa9 \xe2\x82\xac\";\n";
+	for (size_t i = 0; i < TEXT_LEN; i++) {
+		g_text[i] = line[i % (sizeof(line) - 1)];
+	}
+}
+
+static int write_fifo(void *arg)
+{
+	(void)arg;
+	int fd = open(g_fifo_path, O_WRONLY);
+	if (fd < 0) {
+		return 1;
+	}
+	for (size_t at = 0; at < TEXT_LEN;) {
+		size_t len = TEXT_LEN - at < WRITE_LEN ? TEXT_LEN - at : WRITE_LEN;
+		ssize_t retval = write(fd, g_text + at, len);
+		if (retval <= 0) {
+			break;
+		}
+		at += (size_t)retval;
+	}
+	close(fd);
+	return 0;
+}
+
+static bool check_file(const bc_src_file *file)
+{
+	const bc_imm_str *text = file ? src_file_text(file) : NULL;
+	bool ok = text && imm_str_len(text) == TEXT_LEN &&
+			  !memcmp(imm_str_read(text), g_text, TEXT_LEN);
+	rc_unref(file);
+	return ok;
+}
+
+static bool bench_file(void)
+{
+	double start = bench_now();
+	for (size_t pass = 0; pass < PASS_COUNT; pass++) {
+		const bc_src_file *file = src_file_load(g_file_path);
+		if (!check_file(file)) {
+			return false;
+		}
+		src_file_cache_trim();
+	}
+	double seconds = bench_now() - start;
+	bench_report(
+		"regular file load", seconds, (double)TEXT_LEN * PASS_COUNT / 1e9,
+		"GB/s");
+	return true;
+}
+
+static bool bench_fifo_load(void)
+{
+	double seconds = 0;
+	for (size_t pass = 0; pass < PASS_COUNT; pass++) {
+		thrd_t writer;
+		if (thrd_create(&writer, write_fifo, NULL) != thrd_success) {
+			return false;
+		}
+		double start = bench_now();
+		const bc_src_file *file = src_file_load(g_fifo_path);
+		seconds += bench_now() - start;
+		thrd_join(writer, NULL);
+		if (!check_file(file)) {
+			return false;
+		}
+	}
+	bench_report(
+		"fifo load", seconds, (double)TEXT_LEN * PASS_COUNT / 1e9, "GB/s");
+	return true;
+}
+
+/* Consumes chunks as they arrive, as a lexer fed from a pipe would */
+static bool bench_fifo_stream(void)
+{
+	double seconds = 0;
+	size_t lines = 0;
+	for (size_t pass = 0; pass < PASS_COUNT; pass++) {
+		thrd_t writer;
+		if (thrd_create(&writer, write_fifo, NULL) != thrd_success) {
+			return false;
+		}
+		double start = bench_now();
+		bc_src_stream *stream = src_stream_open(g_fifo_path);
+		const char *chunk;
+		size_t len;
+		while (stream && src_stream_next(stream, &chunk, &len)) {
+			lines += scan_count_newlines(chunk, chunk + len);
+		}
+		const bc_src_file *file = stream ? src_stream_finish(stream) : NULL;
+		seconds += bench_now() - start;
+		thrd_join(writer, NULL);
+		if (!check_file(file)) {
+			return false;
+		}
+	}
+	bench_report(
+		"fifo stream + scan", seconds, (double)TEXT_LEN * PASS_COUNT / 1e9,
+		"GB/s");
+	return lines > 0;
+}
+
+int main(void)
+{
+	g_text = malloc(TEXT_LEN);
+	if (!g_text || !mkdtemp(g_dir)) {
+		return EXIT_FAILURE;
+	}
+	make_text();
+	snprintf(g_file_path, sizeof(g_file_path), "%s/file", g_dir);
+	snprintf(g_fifo_path, sizeof(g_fifo_path), "%s/fifo", g_dir);
+
+	int fd = open(g_file_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	bool ok = fd >= 0 && write(fd, g_text, TEXT_LEN) == TEXT_LEN;
+	if (fd >= 0) {
+		close(fd);
+	}
+	ok = ok && mkfifo(g_fifo_path, 0600) == 0;
+
+	ok = ok && bench_file() && bench_fifo_load() && bench_fifo_stream();
+
+	unlink(g_file_path);
+	unlink(g_fifo_path);
+	rmdir(g_dir);
+	free(g_text);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
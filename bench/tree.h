@@ -0,0 +1,87 @@
+#ifndef BC_BENCH_TREE_H
+#define BC_BENCH_TREE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Synthetic source trees for loader benchmarks */
+
+typedef struct bench_tree {
+	char dir[256];
+	size_t count;
+	size_t total;
+	char **paths;
+} bench_tree;
+
+static inline bool
+write_tree_file(const char *path, size_t len, uint64_t *state)
+{
+	static const char line[] = "\tstatic inline size_t count = at[i] + 1;\n";
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		return false;
+	}
+
+	for (size_t at = 0; at < len;) {
+		*state = *state * 6364136223846793005u + 1442695040888963407u;
+		size_t piece = (size_t)(*state >> 59) + 8;
+		if (piece > len - at) {
+			piece = len - at;
+		}
+		fwrite(line + sizeof(line) - 1 - piece, 1, piece, f);
+		at += piece;
+	}
+	return !fclose(f);
+}
+
+/* File sizes are spread between min_len and max_len. The tree goes under
+ * $BC_BENCH_DIR when set, since /tmp is often tmpfs and never cold. */
+static inline bool bench_tree_create(
+	bench_tree *tree, size_t count, size_t min_len, size_t max_len)
+{
+	const char *parent = getenv("BC_BENCH_DIR");
+	snprintf(
+		tree->dir, sizeof(tree->dir), "%s/bc_bench_XXXXXX",
+		parent ? parent : "/tmp");
+	tree->count = 0;
+	tree->total = 0;
+	tree->paths = calloc(count, sizeof(*tree->paths));
+	if (!tree->paths || !mkdtemp(tree->dir)) {
+		free(tree->paths);
+		return false;
+	}
+
+	uint64_t state = 1;
+	for (size_t i = 0; i < count; i++) {
+		size_t path_len = sizeof(tree->dir) + 16;
+		char *path = malloc(path_len);
+		if (!path) {
+			return false;
+		}
+		tree->paths[tree->count++] = path;
+		snprintf(path, path_len, "%s/f%zu.c", tree->dir, i);
+
+		size_t len = min_len + i * 7919 % (max_len - min_len + 1);
+		if (!write_tree_file(path, len, &state)) {
+			return false;
+		}
+		tree->total += len;
+	}
+	return true;
+}
+
+static inline void bench_tree_destroy(bench_tree *tree)
+{
+	for (size_t i = 0; i < tree->count; i++) {
+		unlink(tree->paths[i]);
+		free(tree->paths[i]);
+	}
+	free(tree->paths);
+	rmdir(tree->dir);
+}
+
+#endif
@@ -1,11 +1,17 @@
 #ifndef BC_CTX_H
 #define BC_CTX_H
 
+#include "loc.h"
+
 #include <stddef.h>
 
-typedef struct bc_ctx bc_ctx;
 typedef struct bc_src_file bc_src_file;
 
+typedef struct bc_ctx {
+	bc_loc start;
+	bc_loc end;
+} bc_ctx;
+
 const bc_src_file *ctx_file(const bc_ctx *ctx);
 const char *ctx_at(const bc_ctx *ctx);
 size_t ctx_len(const bc_ctx *ctx);
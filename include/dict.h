@@ -1,17 +1,43 @@
 #ifndef BC_DICT_H
 #define BC_DICT_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <threads.h>
 
 typedef struct bc_imm_str bc_imm_str;
+typedef struct bc_imm_str_slice bc_imm_str_slice;
 typedef struct bc_dict bc_dict;
 
-const bc_imm_str *dict_node_key(const bc_dict *dict);
+const bc_imm_str_slice *dict_node_key(const bc_dict *dict);
 const void *dict_node_value(const bc_dict *dict);
 
 const bc_dict *dict_find(const bc_dict *dict, const char *key, size_t len);
+const bc_dict *dict_find_str(const bc_dict *dict, const bc_imm_str *key);
 const bc_dict *
 dict_define(const bc_dict **dict_p, const char *key, size_t len, void *value);
 void dict_delete(const bc_dict **dict_p, const char *key, size_t len);
 
+typedef struct bc_dict_stats {
+	size_t count;
+	size_t max_depth;
+	double avg_depth;
+} bc_dict_stats;
+
+bool dict_stats(const bc_dict *dict, bc_dict_stats *stats);
+
+/* Transients */
+
+typedef struct bc_dict_transient {
+	const bc_dict *root;
+	thrd_t owner;
+} bc_dict_transient;
+
+void dict_transient_init(bc_dict_transient *trans, const bc_dict *dict);
+const bc_dict *dict_transient_define(
+	bc_dict_transient *trans, const char *key, size_t len, void *value);
+void dict_transient_delete(
+	bc_dict_transient *trans, const char *key, size_t len);
+const bc_dict *dict_transient_freeze(bc_dict_transient *trans);
+
 #endif
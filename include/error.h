@@ -1,8 +1,11 @@
 #ifndef BC_ERROR_H
 #define BC_ERROR_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
+typedef struct bc_ctx bc_ctx;
+
 enum {
 	BC_ERROR_ABORT,
 	BC_ERROR_NOTE,
@@ -10,11 +13,28 @@ enum {
 	BC_ERROR_FATAL,
 };
 
+enum {
+	BC_ERROR_OUTPUT_TEXT,
+	BC_ERROR_OUTPUT_JSONL,
+	BC_ERROR_OUTPUT_SARIF,
+};
+
 #define BC_ERROR_BUFFER_SIZE 128
 #define BC_ERROR_ALLOC_LEVEL BC_ERROR_FATAL
 
 void error_msg(int level, const char *fmt, ...);
+void error_at(int level, const bc_ctx *ctx, const char *fmt, ...);
 void error_sys(int level, int errnum, const char *fmt, ...);
 void error_alloc(size_t size);
 
+void error_set_output(int output);
+void error_suppress(int level, bool suppressed);
+void error_suppress_fmt(int level, const char *fmt, bool suppressed);
+void error_suppress_at(const bc_ctx *ctx, bool suppressed);
+bool error_enabled(int level);
+void error_set_dedup(bool dedup);
+void error_set_limit(size_t limit);
+void error_defer(bool deferred);
+void error_flush(void);
+
 #endif
@@ -0,0 +1,21 @@
+#ifndef BC_HAMT_H
+#define BC_HAMT_H
+
+#include <stddef.h>
+
+typedef struct bc_imm_str bc_imm_str;
+typedef struct bc_hamt bc_hamt;
+typedef struct bc_hamt_entry bc_hamt_entry;
+
+const bc_imm_str *hamt_entry_key(const bc_hamt_entry *entry);
+const void *hamt_entry_value(const bc_hamt_entry *entry);
+
+const bc_hamt_entry *
+hamt_find(const bc_hamt *hamt, const char *key, size_t len);
+const bc_hamt_entry *
+hamt_find_str(const bc_hamt *hamt, const bc_imm_str *key);
+const bc_hamt_entry *hamt_define(
+	const bc_hamt **hamt_p, const char *key, size_t len, void *value);
+void hamt_delete(const bc_hamt **hamt_p, const char *key, size_t len);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef BC_HASH_H
+#define BC_HASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+	BC_HASH_IMPL_SCALAR,
+	BC_HASH_IMPL_SSE2,
+	BC_HASH_IMPL_AVX2,
+};
+
+uint64_t hash_bytes(const void *src, size_t len);
+bool hash_set_impl(int impl);
+
+#endif
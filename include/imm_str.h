@@ -1,24 +1,101 @@
 #ifndef BC_IMM_STR_H
 #define BC_IMM_STR_H
 
+#include "rc.h"
+
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 typedef struct bc_imm_str bc_imm_str;
 
+#define BC_IMM_STR_STATIC_TYPE(lit) \
+	struct {                        \
+		bc_rc_static tag;           \
+		size_t len;                 \
+		uint64_t hash;              \
+		char data[sizeof(lit)];     \
+	}
+
+#define BC_IMM_STR_STATIC_INIT(lit)                                         \
+	{                                                                       \
+		BC_RC_STATIC_INIT(sizeof(size_t) + sizeof(uint64_t) + sizeof(lit)), \
+		sizeof(lit) - 1,                                                    \
+		0,                                                                  \
+		lit,                                                                \
+	}
+
+/* Only valid at file scope, where the compound literal has static storage.
+ * Inside a function use BC_IMM_STR_DEFINE instead. */
+#define BC_IMM_STR_STATIC(lit)                              \
+	((const bc_imm_str *)&((BC_IMM_STR_STATIC_TYPE(lit))    \
+							   BC_IMM_STR_STATIC_INIT(lit)) \
+		 .len)
+
+#define BC_IMM_STR_DEFINE(name, lit)                   \
+	static BC_IMM_STR_STATIC_TYPE(lit) name##_static = \
+		BC_IMM_STR_STATIC_INIT(lit);                   \
+	static const bc_imm_str *const name =              \
+		(const bc_imm_str *)&name##_static.len
+
 size_t imm_str_len(const bc_imm_str *str);
 const char *imm_str_read(const bc_imm_str *str);
+char *imm_str_write(bc_imm_str *str);
+uint64_t imm_str_hash(const bc_imm_str *str);
+bool imm_str_equal(const bc_imm_str *a, const bc_imm_str *b);
 
+bc_imm_str *imm_str_alloc(size_t len);
+bc_imm_str *imm_str_resize(const bc_imm_str *str, size_t len);
 const bc_imm_str *imm_str_create(const char *src);
 const bc_imm_str *imm_str_create_n(const char *src, size_t len);
 const bc_imm_str *imm_str_from_file(FILE *f, size_t len);
+const bc_imm_str *imm_str_map(int fd, size_t len);
+
+/* Interned strings are immortal and the table never shrinks, so intern only
+ * dict and hamt keys. Past BC_IMM_STR_INTERN_MAX strings the result is an
+ * ordinary copy: release it like any string and compare by content. */
+const bc_imm_str *imm_str_intern(const char *src);
+const bc_imm_str *imm_str_intern_n(const char *src, size_t len);
+
+#define BC_IMM_STR_SLICE_SMALL (SIZE_MAX ^ (SIZE_MAX >> 1))
+
+enum {
+	BC_IMM_STR_SLICE_SMALL_MAX = 2 * sizeof(void *),
+};
 
 typedef struct bc_imm_str_slice {
-	const bc_imm_str *str;
-	const char *at;
+	union {
+		struct {
+			const bc_imm_str *str;
+			const char *at;
+		};
+		char small[BC_IMM_STR_SLICE_SMALL_MAX];
+	};
 	size_t len;
 } bc_imm_str_slice;
 
+static inline bool imm_str_slice_is_small(const bc_imm_str_slice *slice)
+{
+	return slice->len & BC_IMM_STR_SLICE_SMALL;
+}
+
+static inline const bc_imm_str *
+imm_str_slice_str(const bc_imm_str_slice *slice)
+{
+	return imm_str_slice_is_small(slice) ? NULL : slice->str;
+}
+
+static inline const char *imm_str_slice_read(const bc_imm_str_slice *slice)
+{
+	return imm_str_slice_is_small(slice) ? slice->small : slice->at;
+}
+
+static inline size_t imm_str_slice_len(const bc_imm_str_slice *slice)
+{
+	return slice->len & ~BC_IMM_STR_SLICE_SMALL;
+}
+
 void imm_str_slice_init(
 	bc_imm_str_slice *slice, const bc_imm_str *str, const char *at, size_t len);
 void imm_str_slice_reinit(
@@ -0,0 +1,19 @@
+#ifndef BC_LOC_H
+#define BC_LOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct bc_src_file bc_src_file;
+
+typedef uint32_t bc_loc;
+
+#define BC_LOC_NONE ((bc_loc)0)
+
+bc_loc loc_encode(const bc_src_file *file, const char *at);
+const bc_src_file *loc_file(bc_loc loc);
+const char *loc_at(bc_loc loc);
+bool loc_get_pos(size_t *line_dest, size_t *col_dest, bc_loc loc);
+
+#endif
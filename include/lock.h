@@ -0,0 +1,21 @@
+#ifndef BC_LOCK_H
+#define BC_LOCK_H
+
+#include <stdatomic.h>
+
+typedef atomic_flag bc_lock;
+
+#define BC_LOCK_INIT ATOMIC_FLAG_INIT
+
+static inline void lock_acquire(bc_lock *lock)
+{
+	while (atomic_flag_test_and_set_explicit(lock, memory_order_acquire)) {
+	}
+}
+
+static inline void lock_release(bc_lock *lock)
+{
+	atomic_flag_clear_explicit(lock, memory_order_release);
+}
+
+#endif
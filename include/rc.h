@@ -1,14 +1,80 @@
 #ifndef BC_RC_H
 #define BC_RC_H
 
+#include <stdalign.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_RC_COMPACT_HEADER
+#	define BC_RC_COMPACT_HEADER 0
+#endif
 
 void *
 rc_alloc(size_t size, void (*visit)(const void *, void (*)(const void *)));
 size_t rc_size(const void *ptr);
+bool rc_unique(const void *ptr);
 const void *rc_ref(const void *ptr);
 void rc_unref(const void *ptr);
 void *rc_edit(const void *src);
 void *rc_resize(const void *src, size_t size);
+const void *rc_immortalize(const void *ptr);
+
+/* Mapped Objects */
+
+void *rc_alloc_mapped(
+	size_t header_size, int fd, size_t len,
+	void (*visit)(const void *, void (*)(const void *)));
+
+/* Regions */
+
+bool rc_region_push(void);
+void rc_region_pop(void);
+const void *rc_promote(const void *ptr);
+
+/* Deferred Release */
+
+void rc_defer(bool deferred);
+void rc_collect(void);
+bool rc_collector_start(void);
+void rc_collector_stop(void);
+
+/* Static Objects */
+
+#define BC_RC_STATIC_SHARED 5
+#define BC_RC_STATIC_OWNER UINT32_MAX
+#define BC_RC_STATIC_CLASS UINT8_MAX
+#define BC_RC_STATIC_FLAGS 2
+
+#if BC_RC_COMPACT_HEADER
+typedef struct bc_rc_static {
+	alignas(max_align_t) size_t size;
+	alignas(max_align_t) uint32_t ref;
+	uint32_t shared;
+	uint32_t owner;
+	uint16_t type;
+	uint8_t cls;
+	uint8_t flags;
+} bc_rc_static;
+#else
+typedef struct bc_rc_static {
+	alignas(max_align_t) uint32_t ref;
+	uint32_t shared;
+	uint32_t owner;
+	uint16_t type;
+	uint8_t cls;
+	uint8_t flags;
+	size_t size;
+} bc_rc_static;
+#endif
+
+#define BC_RC_STATIC_INIT(data_size)                                        \
+	{                                                                       \
+		.size = (data_size), .ref = 0, .shared = BC_RC_STATIC_SHARED,       \
+		.owner = BC_RC_STATIC_OWNER, .type = 0, .cls = BC_RC_STATIC_CLASS, \
+		.flags = BC_RC_STATIC_FLAGS,                                        \
+	}
 
 #endif
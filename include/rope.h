@@ -0,0 +1,26 @@
+#ifndef BC_ROPE_H
+#define BC_ROPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct bc_imm_str bc_imm_str;
+typedef struct bc_imm_str_slice bc_imm_str_slice;
+typedef struct bc_rope bc_rope;
+
+size_t rope_len(const bc_rope *rope);
+char rope_index(const bc_rope *rope, size_t index);
+
+const bc_rope *rope_from_str(const bc_imm_str *str);
+const bc_rope *
+rope_from_slice(const bc_imm_str *str, const char *at, size_t len);
+const bc_rope *rope_from_str_slice(const bc_imm_str_slice *slice);
+const bc_rope *rope_concat(const bc_rope *left, const bc_rope *right);
+const bc_rope *rope_substr(const bc_rope *rope, size_t start, size_t len);
+
+const bc_imm_str *rope_flatten(const bc_rope *rope);
+bool rope_write(const bc_rope *rope, FILE *f);
+bool rope_write_fd(const bc_rope *rope, int fd);
+
+#endif
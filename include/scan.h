@@ -0,0 +1,24 @@
+#ifndef BC_SCAN_H
+#define BC_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BC_SCAN_SET_MAX 16
+
+enum {
+	BC_SCAN_IMPL_SCALAR,
+	BC_SCAN_IMPL_SSE2,
+	BC_SCAN_IMPL_AVX2,
+};
+
+const char *scan_find_byte(const char *at, const char *end, char byte);
+const char *scan_find_any(
+	const char *at, const char *end, const char *set, size_t set_len);
+const char *scan_skip_ident(const char *at, const char *end);
+size_t scan_count_newlines(const char *at, const char *end);
+size_t scan_index_newlines(const char *at, const char *end, size_t *dest);
+
+bool scan_set_impl(int impl);
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef BC_SEGVEC_H
+#define BC_SEGVEC_H
+
+#include "error.h"
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_SEGVEC_FIRST_SHIFT
+#	define BC_SEGVEC_FIRST_SHIFT 4
+#endif
+
+/* Constants */
+
+enum {
+	BC_SEGVEC_E_ALLOC = -1,
+	BC_SEGVEC_E_UNDERFLOW = -3,
+
+	BC_SEGVEC_SUCCESS = 0,
+};
+
+#define BC_SEGVEC_FIRST_CAP ((size_t)1 << BC_SEGVEC_FIRST_SHIFT)
+#define BC_SEGVEC_MAX_CHUNKS                              \
+	(sizeof(size_t) * CHAR_BIT - BC_SEGVEC_FIRST_SHIFT)
+#define BC_SEGVEC_MAX_CAP(type) (SIZE_MAX / 2 / sizeof(type))
+
+/* Templates */
+
+/* Elements live in chunks that never move, so pointers stay valid until
+ * their elements are removed. Supported: create, destroy, at, span,
+ * reserve, grow, shrink, clear, trunc, trunc_unsafe, pop_n, pop_n_unsafe,
+ * pop_unsafe, push and append. There is no insert, delete or splice, since
+ * those would move elements. */
+
+#define BC_SEGVEC_STRUCT(api, type)        \
+	typedef struct api {                   \
+		size_t len;                        \
+		size_t cap;                        \
+		size_t chunks;                     \
+		type *chunk[BC_SEGVEC_MAX_CHUNKS]; \
+	} api;
+
+#define BC_SEGVEC_LOCATE(api, type)                                          \
+	static inline size_t seg_get_chunk(size_t index)                         \
+	{                                                                        \
+		unsigned long long pos = index + BC_SEGVEC_FIRST_CAP;                \
+		return (size_t)(sizeof(pos) * CHAR_BIT - 1 - __builtin_clzll(pos)) - \
+			   BC_SEGVEC_FIRST_SHIFT;                                        \
+	}                                                                        \
+                                                                             \
+	static inline size_t seg_get_chunk_start(size_t chunk)                   \
+	{                                                                        \
+		return (BC_SEGVEC_FIRST_CAP << chunk) - BC_SEGVEC_FIRST_CAP;         \
+	}                                                                        \
+                                                                             \
+	static inline size_t seg_get_chunk_cap(size_t chunk)                     \
+	{                                                                        \
+		return BC_SEGVEC_FIRST_CAP << chunk;                                 \
+	}                                                                        \
+                                                                             \
+	static inline type *                                                     \
+	seg_locate(api *vec, size_t index, size_t *avail_dest)                   \
+	{                                                                        \
+		size_t chunk = seg_get_chunk(index);                                 \
+		size_t offset = index - seg_get_chunk_start(chunk);                  \
+		*avail_dest = seg_get_chunk_cap(chunk) - offset;                     \
+		return &vec->chunk[chunk][offset];                                   \
+	}                                                                        \
+                                                                             \
+	static inline type *seg_get(api *vec, size_t index)                      \
+	{                                                                        \
+		size_t chunk = seg_get_chunk(index);                                 \
+		return &vec->chunk[chunk][index - seg_get_chunk_start(chunk)];       \
+	}
+
+#define BC_SEGVEC_UPDATE_DUMMY(api, type)               \
+	static inline void seg_update_range(                \
+		api *vec, size_t start_index, size_t end_index) \
+	{                                                   \
+		((void)(vec));                                  \
+		((void)(start_index));                          \
+		((void)(end_index));                            \
+	}
+
+#define BC_SEGVEC_UPDATE_W_UTOR(api, type, utor)           \
+	static inline void seg_update_range(                   \
+		api *vec, size_t start_index, size_t end_index)    \
+	{                                                      \
+		for (size_t i = start_index; i < end_index; i++) { \
+			utor(seg_get(vec, i));                         \
+		}                                                  \
+	}
+
+#define BC_SEGVEC_DESTROY_DUMMY(api, type)              \
+	static inline void seg_destroy_unit(type *unit)     \
+	{                                                   \
+		((void)(unit));                                 \
+	}                                                   \
+                                                        \
+	static inline void seg_destroy_range(               \
+		api *vec, size_t start_index, size_t end_index) \
+	{                                                   \
+		((void)(vec));                                  \
+		((void)(start_index));                          \
+		((void)(end_index));                            \
+	}
+
+#define BC_SEGVEC_DESTROY_W_DTOR(api, type, dtor)       \
+	static inline void seg_destroy_unit(type *unit)     \
+	{                                                   \
+		dtor(unit);                                     \
+	}                                                   \
+                                                        \
+	static inline void seg_destroy_range(               \
+		api *vec, size_t start_index, size_t end_index) \
+	{                                                   \
+		for (size_t i = end_index; i > start_index;) {  \
+			i--;                                        \
+			seg_destroy_unit(seg_get(vec, i));          \
+		}                                               \
+	}
+
+#define BC_SEGVEC_IMPLEMENT(api, type) \
+	BC_SEGVEC_STRUCT(api, type)        \
+	BC_SEGVEC_LOCATE(api, type)        \
+	BC_SEGVEC_UPDATE_DUMMY(api, type)  \
+	BC_SEGVEC_DESTROY_DUMMY(api, type) \
+	BC_SEGVEC_TEMPLATE(api, type)
+
+#define BC_SEGVEC_IMPLEMENT_W_DTOR(api, type, dtor) \
+	BC_SEGVEC_STRUCT(api, type)                     \
+	BC_SEGVEC_LOCATE(api, type)                     \
+	BC_SEGVEC_UPDATE_DUMMY(api, type)               \
+	BC_SEGVEC_DESTROY_W_DTOR(api, type, dtor)       \
+	BC_SEGVEC_TEMPLATE(api, type)
+
+#define BC_SEGVEC_IMPLEMENT_W_UTOR(api, type, utor, dtor) \
+	BC_SEGVEC_STRUCT(api, type)                           \
+	BC_SEGVEC_LOCATE(api, type)                           \
+	BC_SEGVEC_UPDATE_W_UTOR(api, type, utor)              \
+	BC_SEGVEC_DESTROY_W_DTOR(api, type, dtor)             \
+	BC_SEGVEC_TEMPLATE(api, type)
+
+#define BC_SEGVEC_TEMPLATE(api, type)                                        \
+	api *api##_create(void)                                                  \
+	{                                                                        \
+		api *vec = calloc(1, sizeof(*vec));                                  \
+		if (!vec) {                                                          \
+			error_alloc(sizeof(*vec));                                       \
+			return NULL;                                                     \
+		}                                                                    \
+		return vec;                                                          \
+	}                                                                        \
+                                                                             \
+	void api##_destroy(api *vec)                                             \
+	{                                                                        \
+		if (!vec) {                                                          \
+			return;                                                          \
+		}                                                                    \
+                                                                             \
+		seg_destroy_range(vec, 0, vec->len);                                 \
+		for (size_t i = 0; i < vec->chunks; i++) {                           \
+			free(vec->chunk[i]);                                             \
+		}                                                                    \
+		free(vec);                                                           \
+	}                                                                        \
+                                                                             \
+	type *api##_at(api *vec, size_t index)                                   \
+	{                                                                        \
+		return index < vec->len ? seg_get(vec, index) : NULL;                \
+	}                                                                        \
+                                                                             \
+	type *api##_span(api *vec, size_t index, size_t *len_dest)               \
+	{                                                                        \
+		if (index >= vec->len) {                                             \
+			*len_dest = 0;                                                   \
+			return NULL;                                                     \
+		}                                                                    \
+                                                                             \
+		size_t avail;                                                        \
+		type *span = seg_locate(vec, index, &avail);                         \
+		size_t len = vec->len - index;                                       \
+		*len_dest = avail < len ? avail : len;                               \
+		return span;                                                         \
+	}                                                                        \
+                                                                             \
+	static inline bool seg_is_cap_too_high(size_t cap)                       \
+	{                                                                        \
+		if (cap > BC_SEGVEC_MAX_CAP(type)) {                                 \
+			error_msg(                                                       \
+				BC_ERROR_ALLOC_LEVEL,                                        \
+				"Requested segmented vector cap %zu of type %s exceeds the " \
+				"platform maximum %zu",                                      \
+				cap, #type, BC_SEGVEC_MAX_CAP(type));                        \
+			return true;                                                     \
+		}                                                                    \
+		return false;                                                        \
+	}                                                                        \
+                                                                             \
+	int api##_reserve(api *vec, size_t min)                                  \
+	{                                                                        \
+		if (vec->cap >= min) {                                               \
+			return BC_SEGVEC_SUCCESS;                                        \
+		} else if (seg_is_cap_too_high(min)) {                               \
+			return BC_SEGVEC_E_ALLOC;                                        \
+		}                                                                    \
+                                                                             \
+		while (vec->cap < min) {                                             \
+			size_t cap = seg_get_chunk_cap(vec->chunks);                     \
+			size_t total = cap * sizeof(type);                               \
+			type *chunk = malloc(total);                                     \
+			if (!chunk) {                                                    \
+				error_alloc(total);                                          \
+				return BC_SEGVEC_E_ALLOC;                                    \
+			}                                                                \
+                                                                             \
+			vec->chunk[vec->chunks++] = chunk;                               \
+			vec->cap += cap;                                                 \
+		}                                                                    \
+		return BC_SEGVEC_SUCCESS;                                            \
+	}                                                                        \
+                                                                             \
+	int api##_grow(api *vec, size_t request)                                 \
+	{                                                                        \
+		if (vec->cap - vec->len >= request) {                                \
+			return BC_SEGVEC_SUCCESS;                                        \
+		} else if (BC_SEGVEC_MAX_CAP(type) - vec->len < request) {           \
+			error_msg(                                                       \
+				BC_ERROR_ALLOC_LEVEL,                                        \
+				"Requested %s segmented vector growth by %zu exceeds the "   \
+				"platform maximum %zu",                                      \
+				#type, request, BC_SEGVEC_MAX_CAP(type));                    \
+			return BC_SEGVEC_E_ALLOC;                                        \
+		}                                                                    \
+		return api##_reserve(vec, vec->len + request);                       \
+	}                                                                        \
+                                                                             \
+	int api##_shrink(api *vec)                                               \
+	{                                                                        \
+		while (vec->chunks &&                                                \
+			   seg_get_chunk_start(vec->chunks - 1) >= vec->len) {           \
+			vec->chunks--;                                                   \
+			free(vec->chunk[vec->chunks]);                                   \
+			vec->cap -= seg_get_chunk_cap(vec->chunks);                      \
+		}                                                                    \
+		return BC_SEGVEC_SUCCESS;                                            \
+	}                                                                        \
+                                                                             \
+	int api##_clear(api *vec)                                                \
+	{                                                                        \
+		seg_destroy_range(vec, 0, vec->len);                                 \
+		vec->len = 0;                                                        \
+		return BC_SEGVEC_SUCCESS;                                            \
+	}                                                                        \
+                                                                             \
+	int api##_trunc_unsafe(api *vec, size_t len)                             \
+	{                                                                        \
+		size_t tail = vec->len - len;                                        \
+		seg_destroy_range(vec, tail, vec->len);                              \
+		vec->len = tail;                                                     \
+		return BC_SEGVEC_SUCCESS;                                            \
+	}                                                                        \
+                                                                             \
+	int api##_trunc(api *vec, size_t len)                                    \
+	{                                                                        \
+		if (len > vec->len) {                                                \
+			return BC_SEGVEC_E_UNDERFLOW;                                    \
+		}                                                                    \
+		return api##_trunc_unsafe(vec, len);                                 \
+	}                                                                        \
+                                                                             \
+	type api##_pop_unsafe(api *vec)                                          \
+	{                                                                        \
+		vec->len--;                                                          \
+		return *seg_get(vec, vec->len);                                      \
+	}                                                                        \
+                                                                             \
+	int api##_pop_n_unsafe(type *dest, api *vec, size_t n_pop)               \
+	{                                                                        \
+		size_t index = vec->len - n_pop;                                     \
+		while (index < vec->len) {                                           \
+			size_t avail;                                                    \
+			type *src = seg_locate(vec, index, &avail);                      \
+			size_t n = avail < vec->len - index ? avail : vec->len - index;  \
+			memcpy(dest, src, n * sizeof(*dest));                            \
+			dest += n;                                                       \
+			index += n;                                                      \
+		}                                                                    \
+		vec->len -= n_pop;                                                   \
+		return BC_SEGVEC_SUCCESS;                                            \
+	}                                                                        \
+                                                                             \
+	int api##_pop_n(type *dest, api *vec, size_t n_pop)                      \
+	{                                                                        \
+		if (n_pop > vec->len) {                                              \
+			return BC_SEGVEC_E_UNDERFLOW;                                    \
+		}                                                                    \
+		return api##_pop_n_unsafe(dest, vec, n_pop);                         \
+	}                                                                        \
+                                                                             \
+	int api##_push(api *vec, type value)                                     \
+	{                                                                        \
+		int retval = api##_grow(vec, 1);                                     \
+		if (retval) {                                                        \
+			seg_destroy_unit(&value);                                        \
+			return retval;                                                   \
+		}                                                                    \
+                                                                             \
+		*seg_get(vec, vec->len) = value;                                     \
+		vec->len++;                                                          \
+		return BC_SEGVEC_SUCCESS;                                            \
+	}                                                                        \
+                                                                             \
+	int api##_append(api *vec, const type *src, size_t len)                  \
+	{                                                                        \
+		int retval = api##_grow(vec, len);                                   \
+		if (retval) {                                                        \
+			return retval;                                                   \
+		}                                                                    \
+                                                                             \
+		size_t start = vec->len;                                             \
+		while (len) {                                                        \
+			size_t avail;                                                    \
+			type *dest = seg_locate(vec, vec->len, &avail);                  \
+			size_t n = avail < len ? avail : len;                            \
+			memcpy(dest, src, n * sizeof(*src));                             \
+			vec->len += n;                                                   \
+			src += n;                                                        \
+			len -= n;                                                        \
+		}                                                                    \
+		seg_update_range(vec, start, vec->len);                              \
+		return BC_SEGVEC_SUCCESS;                                            \
+	}
+
+#endif
@@ -1,15 +1,45 @@
 #ifndef BC_SRC_FILE_H
 #define BC_SRC_FILE_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct bc_src_file bc_src_file;
 typedef struct bc_imm_str bc_imm_str;
 
 const bc_imm_str *src_file_path(const bc_src_file *file);
 const bc_imm_str *src_file_text(const bc_src_file *file);
+uint32_t src_file_loc_base(const bc_src_file *file);
+void src_file_set_loc_base(const bc_src_file *file, uint32_t base);
+size_t src_file_line_count(const bc_src_file *file);
+bool src_file_get_pos(
+	size_t *line_dest, size_t *col_dest, const bc_src_file *file,
+	const char *at);
 
 const bc_src_file *src_file_load(const char *path_src);
 const bc_src_file *src_file_load_n(const char *path_src, size_t path_len);
 
+typedef void (*bc_src_file_loaded)(
+	void *arg, size_t index, const bc_src_file *file);
+
+bool src_file_load_many(
+	const char *const *paths, size_t count, bc_src_file_loaded callback,
+	void *arg);
+
+void src_file_cache_trim(void);
+void src_file_cache_set_max(size_t max);
+
+/* Streaming */
+
+typedef struct bc_src_stream bc_src_stream;
+
+bc_src_stream *src_stream_open(const char *path_src);
+bc_src_stream *src_stream_open_fd(const char *path_src, int fd);
+bool src_stream_next(
+	bc_src_stream *stream, const char **chunk_dest, size_t *len_dest);
+const char *src_stream_text(const bc_src_stream *stream, size_t *len_dest);
+const bc_src_file *src_stream_finish(bc_src_stream *stream);
+void src_stream_close(bc_src_stream *stream);
+
 #endif
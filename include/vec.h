@@ -764,4 +764,483 @@ enum {
 			vec_p, index, delete_len, src_index, insert_len);                 \
 	}
 
+/* Small Vectors */
+
+#define BC_SMALLVEC_STRUCT(api, type, n) \
+	typedef struct api {                 \
+		size_t cap;                      \
+		size_t len;                      \
+		union {                          \
+			type *heap;                  \
+			type buf[n];                 \
+		} data;                          \
+	} api;
+
+#define BC_SMALLVEC_MAX_CAP(type) (SIZE_MAX / sizeof(type))
+
+#if BC_VEC_GROW_FACTOR
+#	define BC_SMALLVEC_GROW_CAP(type)                                       \
+		static inline size_t small_grow_cap(size_t cap, size_t min)         \
+		{                                                                   \
+			while (cap < min) {                                             \
+				if (cap > BC_SMALLVEC_MAX_CAP(type) / BC_VEC_GROW_FACTOR) { \
+					return BC_SMALLVEC_MAX_CAP(type);                       \
+				}                                                           \
+				cap *= BC_VEC_GROW_FACTOR;                                  \
+			}                                                               \
+			return cap;                                                     \
+		}
+#else
+#	define BC_SMALLVEC_GROW_CAP(type)                               \
+		static inline size_t small_grow_cap(size_t cap, size_t min) \
+		{                                                           \
+			((void)(cap));                                          \
+			return min;                                             \
+		}
+#endif
+
+#define BC_SMALLVEC_UPDATE_DUMMY(type)                    \
+	static inline void small_update_range(                \
+		type *elem, size_t start_index, size_t end_index) \
+	{                                                     \
+		((void)(elem));                                   \
+		((void)(start_index));                            \
+		((void)(end_index));                              \
+	}
+
+#define BC_SMALLVEC_UPDATE_W_UTOR(type, utor)              \
+	static inline void small_update_range(                 \
+		type *elem, size_t start_index, size_t end_index)  \
+	{                                                      \
+		for (size_t i = start_index; i < end_index; i++) { \
+			utor(&elem[i]);                                \
+		}                                                  \
+	}
+
+#define BC_SMALLVEC_DESTROY_DUMMY(type)                   \
+	static inline void small_destroy_unit(type *unit)     \
+	{                                                     \
+		((void)(unit));                                   \
+	}                                                     \
+                                                          \
+	static inline void small_destroy_range(               \
+		type *elem, size_t start_index, size_t end_index) \
+	{                                                     \
+		((void)(elem));                                   \
+		((void)(start_index));                            \
+		((void)(end_index));                              \
+	}
+
+#define BC_SMALLVEC_DESTROY_W_DTOR(type, dtor)            \
+	static inline void small_destroy_unit(type *unit)     \
+	{                                                     \
+		dtor(unit);                                       \
+	}                                                     \
+                                                          \
+	static inline void small_destroy_range(               \
+		type *elem, size_t start_index, size_t end_index) \
+	{                                                     \
+		for (size_t i = end_index; i > start_index;) {    \
+			i--;                                          \
+			small_destroy_unit(&elem[i]);                 \
+		}                                                 \
+	}
+
+#define BC_SMALLVEC_IMPLEMENT(api, type, n) \
+	BC_SMALLVEC_STRUCT(api, type, n)        \
+	BC_SMALLVEC_UPDATE_DUMMY(type)          \
+	BC_SMALLVEC_DESTROY_DUMMY(type)         \
+	BC_SMALLVEC_TEMPLATE(api, type, n)
+
+#define BC_SMALLVEC_IMPLEMENT_W_DTOR(api, type, n, dtor) \
+	BC_SMALLVEC_STRUCT(api, type, n)                     \
+	BC_SMALLVEC_UPDATE_DUMMY(type)                       \
+	BC_SMALLVEC_DESTROY_W_DTOR(type, dtor)               \
+	BC_SMALLVEC_TEMPLATE(api, type, n)
+
+#define BC_SMALLVEC_IMPLEMENT_W_UTOR(api, type, n, utor, dtor) \
+	BC_SMALLVEC_STRUCT(api, type, n)                           \
+	BC_SMALLVEC_UPDATE_W_UTOR(type, utor)                      \
+	BC_SMALLVEC_DESTROY_W_DTOR(type, dtor)                     \
+	BC_SMALLVEC_TEMPLATE(api, type, n)
+
+#define BC_SMALLVEC_TEMPLATE(api, type, n)                                    \
+	BC_SMALLVEC_GROW_CAP(type)                                                \
+                                                                              \
+	static inline bool small_is_heap(const api *vec)                          \
+	{                                                                         \
+		return vec->cap > (n);                                                \
+	}                                                                         \
+                                                                              \
+	type *api##_elem(api *vec)                                                \
+	{                                                                         \
+		return small_is_heap(vec) ? vec->data.heap : vec->data.buf;           \
+	}                                                                         \
+                                                                              \
+	void api##_init(api *vec)                                                 \
+	{                                                                         \
+		vec->cap = (n);                                                       \
+		vec->len = 0;                                                         \
+	}                                                                         \
+                                                                              \
+	void api##_destroy(api *vec)                                              \
+	{                                                                         \
+		small_destroy_range(api##_elem(vec), 0, vec->len);                    \
+		if (small_is_heap(vec)) {                                             \
+			free(vec->data.heap);                                             \
+		}                                                                     \
+		api##_init(vec);                                                      \
+	}                                                                         \
+                                                                              \
+	static inline int small_fatal_error(api *vec, int status)                 \
+	{                                                                         \
+		api##_destroy(vec);                                                   \
+		return status;                                                        \
+	}                                                                         \
+                                                                              \
+	static inline bool small_is_cap_too_high(size_t cap)                      \
+	{                                                                         \
+		if (cap > BC_SMALLVEC_MAX_CAP(type)) {                                \
+			error_msg(                                                        \
+				BC_ERROR_ALLOC_LEVEL,                                         \
+				"Requested small vector cap %zu of type %s exceeds the "      \
+				"platform maximum %zu",                                       \
+				cap, #type, BC_SMALLVEC_MAX_CAP(type));                       \
+			return true;                                                      \
+		}                                                                     \
+		return false;                                                         \
+	}                                                                         \
+                                                                              \
+	int api##_reserve(api *vec, size_t min)                                   \
+	{                                                                         \
+		if (vec->cap >= min) {                                                \
+			return BC_VEC_SUCCESS;                                            \
+		} else if (small_is_cap_too_high(min)) {                              \
+			return small_fatal_error(vec, BC_VEC_E_ALLOC);                    \
+		}                                                                     \
+                                                                              \
+		size_t cap = small_grow_cap(vec->cap, min);                           \
+		size_t total = cap * sizeof(type);                                    \
+		type *heap;                                                           \
+		if (small_is_heap(vec)) {                                             \
+			heap = realloc(vec->data.heap, total);                            \
+		} else if ((heap = malloc(total))) {                                  \
+			memcpy(heap, vec->data.buf, vec->len * sizeof(type));             \
+		}                                                                     \
+                                                                              \
+		if (!heap) {                                                          \
+			error_alloc(total);                                               \
+			return small_fatal_error(vec, BC_VEC_E_ALLOC);                    \
+		}                                                                     \
+                                                                              \
+		vec->data.heap = heap;                                                \
+		vec->cap = cap;                                                       \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	int api##_grow(api *vec, size_t request)                                  \
+	{                                                                         \
+		if (vec->cap - vec->len >= request) {                                 \
+			return BC_VEC_SUCCESS;                                            \
+		} else if (BC_SMALLVEC_MAX_CAP(type) - vec->len < request) {          \
+			error_msg(                                                        \
+				BC_ERROR_ALLOC_LEVEL,                                         \
+				"Requested %s small vector growth by %zu exceeds the "        \
+				"platform maximum %zu",                                       \
+				#type, request, BC_SMALLVEC_MAX_CAP(type));                   \
+			return small_fatal_error(vec, BC_VEC_E_ALLOC);                    \
+		}                                                                     \
+		return api##_reserve(vec, vec->len + request);                        \
+	}                                                                         \
+                                                                              \
+	static inline void small_move_inline(api *vec)                            \
+	{                                                                         \
+		type *heap = vec->data.heap;                                          \
+		memcpy(vec->data.buf, heap, vec->len * sizeof(type));                 \
+		free(heap);                                                           \
+		vec->cap = (n);                                                       \
+	}                                                                         \
+                                                                              \
+	int api##_shrink(api *vec)                                                \
+	{                                                                         \
+		if (!small_is_heap(vec) || vec->len == vec->cap) {                    \
+			return BC_VEC_SUCCESS;                                            \
+		} else if (vec->len <= (n)) {                                         \
+			small_move_inline(vec);                                           \
+			return BC_VEC_SUCCESS;                                            \
+		}                                                                     \
+                                                                              \
+		size_t total = vec->len * sizeof(type);                               \
+		type *heap = realloc(vec->data.heap, total);                          \
+		if (!heap) {                                                          \
+			error_alloc(total);                                               \
+			return small_fatal_error(vec, BC_VEC_E_ALLOC);                    \
+		}                                                                     \
+                                                                              \
+		vec->data.heap = heap;                                                \
+		vec->cap = vec->len;                                                  \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	static inline int small_request_shrink(api *vec)                          \
+	{                                                                         \
+		if (small_is_heap(vec) && vec->len <= (n) / 2) {                      \
+			small_move_inline(vec);                                           \
+		}                                                                     \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	int api##_clear(api *vec)                                                 \
+	{                                                                         \
+		small_destroy_range(api##_elem(vec), 0, vec->len);                    \
+		vec->len = 0;                                                         \
+		return small_request_shrink(vec);                                     \
+	}                                                                         \
+                                                                              \
+	int api##_trunc_unsafe(api *vec, size_t len)                              \
+	{                                                                         \
+		size_t tail = vec->len - len;                                         \
+		small_destroy_range(api##_elem(vec), tail, vec->len);                 \
+		vec->len = tail;                                                      \
+		return small_request_shrink(vec);                                     \
+	}                                                                         \
+                                                                              \
+	int api##_pop_n_unsafe(type *dest, api *vec, size_t n_pop)                \
+	{                                                                         \
+		type *elem = api##_elem(vec);                                         \
+		memcpy(dest, &elem[vec->len - n_pop], n_pop * sizeof(*dest));         \
+		vec->len -= n_pop;                                                    \
+		return small_request_shrink(vec);                                     \
+	}                                                                         \
+                                                                              \
+	type api##_pop_unsafe(api *vec)                                           \
+	{                                                                         \
+		type value = api##_elem(vec)[vec->len - 1];                           \
+		vec->len--;                                                           \
+		small_request_shrink(vec);                                            \
+		return value;                                                         \
+	}                                                                         \
+                                                                              \
+	static inline void small_shift_tail(                                      \
+		api *vec, size_t dest_index, size_t src_index)                        \
+	{                                                                         \
+		type *elem = api##_elem(vec);                                         \
+		memmove(                                                              \
+			elem + dest_index, elem + src_index,                              \
+			(vec->len - src_index) * sizeof(type));                           \
+	}                                                                         \
+                                                                              \
+	int api##_delete_unsafe(api *vec, size_t index, size_t len)               \
+	{                                                                         \
+		small_destroy_range(api##_elem(vec), index, index + len);             \
+		small_shift_tail(vec, index, index + len);                            \
+		vec->len -= len;                                                      \
+		return small_request_shrink(vec);                                     \
+	}                                                                         \
+                                                                              \
+	static inline void small_perform_splice(                                  \
+		api *vec, size_t index, size_t delete_len, const type *src,           \
+		size_t insert_len, bool update)                                       \
+	{                                                                         \
+		type *elem = api##_elem(vec);                                         \
+		small_destroy_range(elem, index, index + delete_len);                 \
+		small_shift_tail(vec, index + insert_len, index + delete_len);        \
+		memcpy(&elem[index], src, insert_len * sizeof(*src));                 \
+		if (update) {                                                         \
+			small_update_range(elem, index, index + insert_len);              \
+		}                                                                     \
+		vec->len += insert_len - delete_len;                                  \
+	}                                                                         \
+                                                                              \
+	int api##_splice_unsafe(                                                  \
+		api *vec, size_t index, size_t delete_len, const type *src,           \
+		size_t insert_len)                                                    \
+	{                                                                         \
+		if (insert_len > delete_len) {                                        \
+			int retval = api##_grow(vec, insert_len - delete_len);            \
+			if (retval) {                                                     \
+				return retval;                                                \
+			}                                                                 \
+		}                                                                     \
+                                                                              \
+		small_perform_splice(vec, index, delete_len, src, insert_len, true);  \
+		if (delete_len > insert_len) {                                        \
+			return small_request_shrink(vec);                                 \
+		}                                                                     \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	int api##_insert_unsafe(                                                  \
+		api *vec, size_t index, const type *src, size_t len)                  \
+	{                                                                         \
+		return api##_splice_unsafe(vec, index, 0, src, len);                  \
+	}                                                                         \
+                                                                              \
+	int api##_overwrite_unsafe(                                               \
+		api *vec, size_t index, const type *src, size_t len)                  \
+	{                                                                         \
+		type *elem = api##_elem(vec);                                         \
+		small_destroy_range(elem, index, index + len);                        \
+		memcpy(&elem[index], src, len * sizeof(*src));                        \
+		small_update_range(elem, index, index + len);                         \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	int api##_trunc(api *vec, size_t len)                                     \
+	{                                                                         \
+		if (len > vec->len) {                                                 \
+			return BC_VEC_E_UNDERFLOW;                                        \
+		}                                                                     \
+		return api##_trunc_unsafe(vec, len);                                  \
+	}                                                                         \
+                                                                              \
+	int api##_delete(api *vec, size_t index, size_t len)                      \
+	{                                                                         \
+		if (index > vec->len) {                                               \
+			return BC_VEC_E_BOUNDS;                                           \
+		} else if (vec->len - index < len) {                                  \
+			return BC_VEC_E_UNDERFLOW;                                        \
+		}                                                                     \
+		return api##_delete_unsafe(vec, index, len);                          \
+	}                                                                         \
+                                                                              \
+	static inline bool small_is_inplace(api *vec, const type *src)            \
+	{                                                                         \
+		uintptr_t elem_uptr = (uintptr_t)api##_elem(vec);                     \
+		uintptr_t src_uptr = (uintptr_t)src;                                  \
+		return src_uptr >= elem_uptr &&                                       \
+			   src_uptr < elem_uptr + vec->len * sizeof(type);                \
+	}                                                                         \
+                                                                              \
+	static inline size_t small_get_index(api *vec, const type *src)           \
+	{                                                                         \
+		uintptr_t elem_uptr = (uintptr_t)api##_elem(vec);                     \
+		return (size_t)(((uintptr_t)src - elem_uptr) / sizeof(type));         \
+	}                                                                         \
+                                                                              \
+	int api##_insert(api *vec, size_t index, const type *src, size_t len)     \
+	{                                                                         \
+		if (index > vec->len) {                                               \
+			return BC_VEC_E_BOUNDS;                                           \
+		} else if (!small_is_inplace(vec, src)) {                             \
+			return api##_insert_unsafe(vec, index, src, len);                 \
+		}                                                                     \
+                                                                              \
+		size_t src_index = small_get_index(vec, src);                         \
+		int retval = api##_grow(vec, len);                                    \
+		if (retval) {                                                         \
+			return retval;                                                    \
+		}                                                                     \
+                                                                              \
+		type *elem = api##_elem(vec);                                         \
+		small_shift_tail(vec, index + len, index);                            \
+		size_t head = 0;                                                      \
+		if (src_index < index) {                                              \
+			head = index - src_index < len ? index - src_index : len;         \
+			memcpy(&elem[index], &elem[src_index], head * sizeof(type));      \
+		}                                                                     \
+		memcpy(                                                               \
+			&elem[index + head], &elem[src_index + head + len],               \
+			(len - head) * sizeof(type));                                     \
+		small_update_range(elem, index, index + len);                         \
+		vec->len += len;                                                      \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	int api##_append(api *vec, const type *src, size_t len)                   \
+	{                                                                         \
+		if (small_is_inplace(vec, src)) {                                     \
+			return api##_insert(vec, vec->len, src, len);                     \
+		}                                                                     \
+                                                                              \
+		int retval = api##_grow(vec, len);                                    \
+		if (retval) {                                                         \
+			return retval;                                                    \
+		}                                                                     \
+                                                                              \
+		type *elem = api##_elem(vec);                                         \
+		memcpy(&elem[vec->len], src, len * sizeof(*src));                     \
+		small_update_range(elem, vec->len, vec->len + len);                   \
+		vec->len += len;                                                      \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	int api##_push(api *vec, type value)                                      \
+	{                                                                         \
+		int retval = api##_grow(vec, 1);                                      \
+		if (retval) {                                                         \
+			small_destroy_unit(&value);                                       \
+			return retval;                                                    \
+		}                                                                     \
+                                                                              \
+		api##_elem(vec)[vec->len] = value;                                    \
+		vec->len++;                                                           \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	static inline int small_splice_inplace(                                   \
+		api *vec, size_t index, size_t delete_len, const type *src,           \
+		size_t insert_len)                                                    \
+	{                                                                         \
+		size_t src_index = small_get_index(vec, src);                         \
+		if (insert_len > delete_len) {                                        \
+			int retval = api##_grow(vec, insert_len - delete_len);            \
+			if (retval) {                                                     \
+				return retval;                                                \
+			}                                                                 \
+		}                                                                     \
+                                                                              \
+		type buf[n];                                                          \
+		type *copy = buf;                                                     \
+		size_t total = insert_len * sizeof(type);                             \
+		if (insert_len > (n) && !(copy = malloc(total))) {                    \
+			error_alloc(total);                                               \
+			return small_fatal_error(vec, BC_VEC_E_ALLOC);                    \
+		}                                                                     \
+		memcpy(copy, &api##_elem(vec)[src_index], total);                     \
+		small_update_range(copy, 0, insert_len);                              \
+                                                                              \
+		small_perform_splice(                                                 \
+			vec, index, delete_len, (const type *)copy, insert_len, false);   \
+		if (copy != buf) {                                                    \
+			free(copy);                                                       \
+		}                                                                     \
+                                                                              \
+		if (delete_len > insert_len) {                                        \
+			return small_request_shrink(vec);                                 \
+		}                                                                     \
+		return BC_VEC_SUCCESS;                                                \
+	}                                                                         \
+                                                                              \
+	int api##_overwrite(api *vec, size_t index, const type *src, size_t len)  \
+	{                                                                         \
+		if (index > vec->len) {                                               \
+			return BC_VEC_E_BOUNDS;                                           \
+		} else if (vec->len - index < len) {                                  \
+			return BC_VEC_E_OVERFLOW;                                         \
+		} else if (!small_is_inplace(vec, src)) {                             \
+			return api##_overwrite_unsafe(vec, index, src, len);              \
+		}                                                                     \
+		return small_splice_inplace(vec, index, len, src, len);               \
+	}                                                                         \
+                                                                              \
+	int api##_splice(                                                         \
+		api *vec, size_t index, size_t delete_len, const type *src,           \
+		size_t insert_len)                                                    \
+	{                                                                         \
+		if (!delete_len) {                                                    \
+			return api##_insert(vec, index, src, insert_len);                 \
+		} else if (!insert_len) {                                             \
+			return api##_delete(vec, index, delete_len);                      \
+		} else if (index > vec->len) {                                        \
+			return BC_VEC_E_BOUNDS;                                           \
+		} else if (vec->len - index < delete_len) {                           \
+			return BC_VEC_E_UNDERFLOW;                                        \
+		} else if (!small_is_inplace(vec, src)) {                             \
+			return api##_splice_unsafe(                                       \
+				vec, index, delete_len, src, insert_len);                     \
+		}                                                                     \
+		return small_splice_inplace(vec, index, delete_len, src, insert_len); \
+	}
+
 #endif
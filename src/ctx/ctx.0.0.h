@@ -1,64 +1,63 @@
 #include "ctx.h"
-#include "rc.h"
-#include "src_file.h"
+#include "loc.h"
 
 #include <stddef.h>
 
-typedef struct bc_ctx {
-	const bc_src_file *file;
-	const char *at;
-	size_t len;
-	size_t start_line;
-	size_t start_col;
-	size_t end_line;
-	size_t end_col;
-} bc_ctx;
-
 const bc_src_file *ctx_file(const bc_ctx *ctx)
 {
-	return ctx->file;
+	return loc_file(ctx->start);
 }
 
 const char *ctx_at(const bc_ctx *ctx)
 {
-	return ctx->at;
+	return loc_at(ctx->start);
 }
 
 size_t ctx_len(const bc_ctx *ctx)
 {
-	return ctx->len;
+	return ctx->end - ctx->start;
+}
+
+static inline void get_pos(size_t *line_dest, size_t *col_dest, bc_loc loc)
+{
+	if (!loc_get_pos(line_dest, col_dest, loc)) {
+		*line_dest = 0;
+		*col_dest = 0;
+	}
 }
 
 const char *
 ctx_get_start(size_t *line_dest, size_t *col_dest, const bc_ctx *ctx)
 {
-	*line_dest = ctx->start_line;
-	*col_dest = ctx->start_col;
-	return ctx->at;
+	get_pos(line_dest, col_dest, ctx->start);
+	return loc_at(ctx->start);
 }
 
 const char *ctx_get_end(size_t *line_dest, size_t *col_dest, const bc_ctx *ctx)
 {
-	*line_dest = ctx->end_line;
-	*col_dest = ctx->end_col;
-	return ctx->at + ctx->len;
+	get_pos(line_dest, col_dest, ctx->end);
+	return loc_at(ctx->end);
 }
 
 void ctx_init(bc_ctx *ctx, const bc_src_file *file, const char *at, size_t len)
 {
-	ctx->file = file;
-	ctx->at = at;
-	ctx->len = len;
+	if (!file) {
+		ctx->start = BC_LOC_NONE;
+		ctx->end = BC_LOC_NONE;
+		return;
+	}
+
+	ctx->start = loc_encode(file, at);
+	ctx->end = ctx->start ? ctx->start + (bc_loc)len : BC_LOC_NONE;
 }
 
 void ctx_reinit(
 	bc_ctx *ctx, const bc_src_file *file, const char *at, size_t len)
 {
-	rc_unref(ctx->file);
 	ctx_init(ctx, file, at, len);
 }
 
 void ctx_clear(bc_ctx *ctx)
 {
-	ctx_reinit(ctx, NULL, NULL, 0);
+	ctx_init(ctx, NULL, NULL, 0);
 }
@@ -1,22 +1,27 @@
 #include "dict.h"
+#include "error.h"
+#include "hash.h"
 #include "imm_str.h"
 #include "rc.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
 typedef struct bc_dict {
-	const bc_imm_str *key;
+	bc_imm_str_slice key;
 	const void *value;
 	struct bc_dict *left;
 	struct bc_dict *right;
 	uint32_t priority;
 } bc_dict;
 
-const bc_imm_str *dict_node_key(const bc_dict *node)
+const bc_imm_str_slice *dict_node_key(const bc_dict *node)
 {
-	return node->key;
+	return &node->key;
 }
 
 const void *dict_node_value(const bc_dict *node)
@@ -27,36 +32,47 @@ const void *dict_node_value(const bc_dict *node)
 static void dict_visit(const void *dict_ptr, void (*visitor)(const void *))
 {
 	const bc_dict *dict = dict_ptr;
-	visitor(dict->key);
+	visitor(imm_str_slice_str(&dict->key));
 	visitor(dict->value);
 	visitor(dict->left);
 	visitor(dict->right);
 }
 
+static inline uint32_t get_key_priority(const bc_imm_str_slice *key)
+{
+	const bc_imm_str *str = imm_str_slice_str(key);
+	if (str) {
+		return (uint32_t)(imm_str_hash(str) >> 32);
+	}
+	return (uint32_t)(
+		hash_bytes(imm_str_slice_read(key), imm_str_slice_len(key)) >> 32);
+}
+
 static inline bc_dict *create_node(
-	const bc_imm_str *key, const void *value, bc_dict *left, bc_dict *right)
+	const bc_imm_str_slice *key, const void *value, bc_dict *left,
+	bc_dict *right)
 {
 	bc_dict *node = rc_alloc(sizeof(bc_dict), dict_visit);
 	if (!node) {
-		rc_unref(key);
+		rc_unref(imm_str_slice_str(key));
 		rc_unref(value);
 		rc_unref(left);
 		rc_unref(right);
 		return NULL;
 	}
 
-	node->key = key;
+	node->key = *key;
 	node->value = value;
 	node->left = left;
 	node->right = right;
+	node->priority = get_key_priority(key);
 	return node;
 }
 
 static inline int compare_keys(const bc_dict *node, const char *key, size_t len)
 {
-	const bc_imm_str *target_str = node->key;
-	const char *target = imm_str_read(target_str);
-	size_t target_len = imm_str_len(target_str);
+	const char *target = imm_str_slice_read(&node->key);
+	size_t target_len = imm_str_slice_len(&node->key);
 
 	if (target_len < len) {
 		int cmp = memcmp(target, key, target_len);
@@ -89,32 +105,57 @@ const bc_dict *dict_find(const bc_dict *dict, const char *key, size_t len)
 	return NULL;
 }
 
+const bc_dict *dict_find_str(const bc_dict *dict, const bc_imm_str *key)
+{
+	const char *key_src = imm_str_read(key);
+	size_t key_len = imm_str_len(key);
+	while (dict) {
+		if (imm_str_slice_str(&dict->key) == key) {
+			return dict;
+		}
+
+		int cmp = compare_keys(dict, key_src, key_len);
+		if (cmp > 0) {
+			dict = dict->left;
+		} else if (cmp < 0) {
+			dict = dict->right;
+		} else {
+			return dict;
+		}
+	}
+	return NULL;
+}
+
 static inline bc_dict *split_dict(
 	bc_dict **left_p, bc_dict **right_p, const bc_dict *dict, const char *key,
 	size_t len)
 {
+	bc_dict **left_root = left_p;
+	bc_dict **right_root = right_p;
 	*left_p = NULL;
 	*right_p = NULL;
 
 	while (dict) {
 		bc_dict *node = rc_edit(dict);
 		if (!node) {
-			rc_unref(*left_p);
 			*left_p = NULL;
-			rc_unref(*right_p);
 			*right_p = NULL;
+			rc_unref(*left_root);
+			*left_root = NULL;
+			rc_unref(*right_root);
+			*right_root = NULL;
 			return NULL;
 		}
 
 		int cmp = compare_keys(node, key, len);
-		if (cmp > 0) {
+		if (cmp < 0) {
 			*left_p = node;
 			left_p = &node->right;
-			node = *left_p;
-		} else if (cmp < 0) {
+			dict = *left_p;
+		} else if (cmp > 0) {
 			*right_p = node;
 			right_p = &node->left;
-			node = *right_p;
+			dict = *right_p;
 		} else {
 			*left_p = node->left;
 			node->left = NULL;
@@ -133,12 +174,19 @@ static inline bc_dict *split_dict(
 static inline bc_dict *
 leaf_node(const char *key_src, size_t key_len, const void *value)
 {
-	const bc_imm_str *key = imm_str_create_n(key_src, key_len);
-	if (!key) {
-		rc_unref(value);
-		return NULL;
+	const bc_imm_str *str = NULL;
+	if (key_len > BC_IMM_STR_SLICE_SMALL_MAX) {
+		str = imm_str_intern_n(key_src, key_len);
+		if (!str) {
+			rc_unref(value);
+			return NULL;
+		}
+		key_src = imm_str_read(str);
 	}
-	return create_node(key, value, NULL, NULL);
+
+	bc_imm_str_slice key;
+	imm_str_slice_init(&key, str, key_src, key_len);
+	return create_node(&key, value, NULL, NULL);
 }
 
 static inline bc_dict *rejoin_dict(bc_dict *left, bc_dict *right)
@@ -214,3 +262,147 @@ void dict_delete(const bc_dict **dict_p, const char *key, size_t len)
 	}
 	*dict_p = rejoin_dict(left, right);
 }
+
+typedef struct bc_dict_frame {
+	const bc_dict *node;
+	size_t depth;
+} bc_dict_frame;
+
+bool dict_stats(const bc_dict *dict, bc_dict_stats *stats)
+{
+	*stats = (bc_dict_stats){0};
+	if (!dict) {
+		return true;
+	}
+
+	size_t cap = 64;
+	bc_dict_frame *stack = malloc(cap * sizeof(*stack));
+	if (!stack) {
+		error_alloc(cap * sizeof(*stack));
+		return false;
+	}
+
+	size_t len = 0;
+	size_t total_depth = 0;
+	stack[len++] = (bc_dict_frame){dict, 1};
+	while (len) {
+		bc_dict_frame frame = stack[--len];
+		stats->count++;
+		total_depth += frame.depth;
+		if (frame.depth > stats->max_depth) {
+			stats->max_depth = frame.depth;
+		}
+
+		if (len + 2 > cap) {
+			bc_dict_frame *grown = realloc(stack, cap * 2 * sizeof(*stack));
+			if (!grown) {
+				error_alloc(cap * 2 * sizeof(*stack));
+				free(stack);
+				return false;
+			}
+			stack = grown;
+			cap *= 2;
+		}
+
+		if (frame.node->left) {
+			stack[len++] = (bc_dict_frame){frame.node->left, frame.depth + 1};
+		}
+		if (frame.node->right) {
+			stack[len++] = (bc_dict_frame){frame.node->right, frame.depth + 1};
+		}
+	}
+
+	free(stack);
+	stats->avg_depth = (double)total_depth / (double)stats->count;
+	return true;
+}
+
+/* Transients */
+
+void dict_transient_init(bc_dict_transient *trans, const bc_dict *dict)
+{
+	trans->root = dict;
+	trans->owner = thrd_current();
+}
+
+static inline bool is_transient_owner(const bc_dict_transient *trans)
+{
+	if (thrd_equal(trans->owner, thrd_current())) {
+		return true;
+	}
+	error_msg(
+		BC_ERROR_ABORT, "Transient dict edited outside of its owning thread");
+	return false;
+}
+
+/* Walks down editing nodes in place until the key is found or the new
+ * node's priority belongs above the current subtree, which is then split */
+static inline bc_dict *
+insert_path(const bc_dict **root_p, const char *key, size_t len, void *value)
+{
+	uint32_t priority = (uint32_t)(hash_bytes(key, len) >> 32);
+	const bc_dict **slot = root_p;
+	while (*slot) {
+		bc_dict *node = rc_edit(*slot);
+		*slot = node;
+		if (!node) {
+			rc_unref(value);
+			rc_unref(*root_p);
+			*root_p = NULL;
+			return NULL;
+		}
+
+		int cmp = compare_keys(node, key, len);
+		if (!cmp) {
+			rc_unref(node->value);
+			node->value = value;
+			return node;
+		} else if (node->priority < priority) {
+			break;
+		}
+		slot = (const bc_dict **)(cmp > 0 ? &node->left : &node->right);
+	}
+
+	bc_dict *left, *right;
+	bc_dict *node = split_dict(&left, &right, *slot, key, len);
+	if (node) {
+		rc_unref(node->value);
+		node->value = value;
+	} else {
+		node = leaf_node(key, len, value);
+	}
+
+	if (!node) {
+		*slot = rejoin_dict(left, right);
+		return NULL;
+	}
+	node->left = left;
+	node->right = right;
+	*slot = node;
+	return node;
+}
+
+const bc_dict *dict_transient_define(
+	bc_dict_transient *trans, const char *key, size_t len, void *value)
+{
+	if (!is_transient_owner(trans)) {
+		rc_unref(value);
+		return NULL;
+	}
+	return insert_path(&trans->root, key, len, value);
+}
+
+void dict_transient_delete(
+	bc_dict_transient *trans, const char *key, size_t len)
+{
+	if (is_transient_owner(trans)) {
+		dict_delete(&trans->root, key, len);
+	}
+}
+
+const bc_dict *dict_transient_freeze(bc_dict_transient *trans)
+{
+	const bc_dict *dict = trans->root;
+	trans->root = NULL;
+	return dict;
+}
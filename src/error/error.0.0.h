@@ -1,17 +1,47 @@
+#include "ctx.h"
 #include "error.h"
+#include "hash.h"
+#include "imm_str.h"
+#include "lock.h"
+#include "src_file.h"
 
 #include <errno.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
+#include <threads.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_ERROR_TEXT_INIT_CAP
+#	define BC_ERROR_TEXT_INIT_CAP 4096
+#endif
+
+#ifndef BC_ERROR_DIAG_INIT_CAP
+#	define BC_ERROR_DIAG_INIT_CAP 64
+#endif
+
+#ifndef BC_ERROR_IOV_MAX
+#	define BC_ERROR_IOV_MAX 1024
+#endif
+
+#ifndef BC_ERROR_FILTER_INIT_CAP
+#	define BC_ERROR_FILTER_INIT_CAP 64
+#endif
 
 enum {
 	BC_ERROR_USE_FMT_ANSI,
 };
 
 static int g_use_fmt = BC_ERROR_USE_FMT_ANSI;
+static atomic_int g_output = BC_ERROR_OUTPUT_TEXT;
 
 static inline const char *get_level_fmt_ansi(int level)
 {
@@ -61,18 +91,1101 @@ static inline const char *get_level_text(int level)
 	}
 }
 
-static inline void begin_msg_v(int level, const char *fmt, va_list args)
+static inline const char *get_sys_msg(char *buf, size_t size, int errnum)
+{
+#ifdef _GNU_SOURCE
+	return strerror_r(errnum, buf, size);
+#else
+	switch (strerror_r(errnum, buf, size)) {
+	case EINVAL:
+		snprintf(buf, size, "strerror_r: Unknown errno %d", errnum);
+		break;
+	case ERANGE:
+		snprintf(
+			buf, size, "strerror_r: Insufficient error buffer size %zu", size);
+		break;
+	default:
+		break;
+	}
+	return buf;
+#endif
+}
+
+/* Text Buffers */
+
+typedef struct bc_error_text {
+	char *data;
+	size_t len;
+	size_t cap;
+} bc_error_text;
+
+static inline bool reserve_text(bc_error_text *text, size_t len)
+{
+	if (text->cap - text->len > len) {
+		return true;
+	}
+
+	size_t cap = text->cap ? text->cap : BC_ERROR_TEXT_INIT_CAP;
+	while (cap - text->len <= len) {
+		cap *= 2;
+	}
+
+	char *data = realloc(text->data, cap);
+	if (!data) {
+		return false;
+	}
+	text->data = data;
+	text->cap = cap;
+	return true;
+}
+
+static inline bool
+append_text_v(bc_error_text *text, const char *fmt, va_list args)
+{
+	va_list retry_args;
+	va_copy(retry_args, args);
+	int len = vsnprintf(
+		text->data + text->len, text->cap - text->len, fmt, args);
+	if (len < 0) {
+		va_end(retry_args);
+		return false;
+	} else if ((size_t)len >= text->cap - text->len) {
+		if (!reserve_text(text, (size_t)len)) {
+			va_end(retry_args);
+			return false;
+		}
+		vsnprintf(
+			text->data + text->len, text->cap - text->len, fmt, retry_args);
+	}
+	va_end(retry_args);
+
+	text->len += (size_t)len;
+	return true;
+}
+
+static inline bool append_text(bc_error_text *text, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	bool ok = append_text_v(text, fmt, args);
+	va_end(args);
+	return ok;
+}
+
+/* Length of the well-formed UTF-8 sequence at src, or 0 if it is not one */
+static inline size_t get_utf8_len(const unsigned char *src, size_t len)
+{
+	unsigned char c = src[0];
+	size_t seq_len;
+	unsigned char low = 0x80;
+	unsigned char high = 0xbf;
+	if (c >= 0xc2 && c <= 0xdf) {
+		seq_len = 2;
+	} else if (c >= 0xe0 && c <= 0xef) {
+		seq_len = 3;
+		low = c == 0xe0 ? 0xa0 : low;
+		high = c == 0xed ? 0x9f : high;
+	} else if (c >= 0xf0 && c <= 0xf4) {
+		seq_len = 4;
+		low = c == 0xf0 ? 0x90 : low;
+		high = c == 0xf4 ? 0x8f : high;
+	} else {
+		return 0;
+	}
+
+	if (len < seq_len || src[1] < low || src[1] > high) {
+		return 0;
+	}
+	for (size_t i = 2; i < seq_len; i++) {
+		if ((src[i] & 0xc0) != 0x80) {
+			return 0;
+		}
+	}
+	return seq_len;
+}
+
+/* Invalid UTF-8 becomes U+FFFD so the output stays valid JSON */
+static inline bool
+append_json_str(bc_error_text *text, const char *src, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	if (!reserve_text(text, 6 * len + 2)) {
+		return false;
+	}
+
+	char *dest = text->data + text->len;
+	*dest++ = '"';
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = (unsigned char)src[i];
+		if (c == '"' || c == '\\') {
+			*dest++ = '\\';
+			*dest++ = (char)c;
+		} else if (c == '\n') {
+			*dest++ = '\\';
+			*dest++ = 'n';
+		} else if (c == '\t') {
+			*dest++ = '\\';
+			*dest++ = 't';
+		} else if (c < 0x20) {
+			memcpy(dest, "\\u00", 4);
+			dest[4] = hex[c >> 4];
+			dest[5] = hex[c & 0xf];
+			dest += 6;
+		} else if (c < 0x80) {
+			*dest++ = (char)c;
+		} else {
+			size_t seq_len =
+				get_utf8_len((const unsigned char *)src + i, len - i);
+			if (!seq_len) {
+				memcpy(dest, "\\ufffd", 6);
+				dest += 6;
+				continue;
+			}
+			memcpy(dest, src + i, seq_len);
+			dest += seq_len;
+			i += seq_len - 1;
+		}
+	}
+	*dest++ = '"';
+
+	text->len = (size_t)(dest - text->data);
+	return true;
+}
+
+static inline const char *get_sarif_level(int level)
+{
+	switch (level) {
+	case BC_ERROR_NOTE:
+		return "note";
+	case BC_ERROR_WARN:
+		return "warning";
+	default:
+		return "error";
+	}
+}
+
+static inline bool format_message(
+	bc_error_text *text, int errnum, const char *fmt, va_list args)
 {
-	fprintf(
-		stderr, "%s%s:%s ", get_level_fmt(level), get_level_text(level),
-		get_fmt_off());
-	vfprintf(stderr, fmt, args);
+	if (!append_text_v(text, fmt, args)) {
+		return false;
+	}
+
+	if (errnum) {
+		char buf[BC_ERROR_BUFFER_SIZE];
+		const char *msg = get_sys_msg(buf, sizeof(buf), errnum);
+		return append_text(text, ": %s", msg);
+	}
+	return true;
+}
+
+static inline bool format_text(
+	bc_error_text *text, int level, const bc_ctx *ctx, int errnum,
+	const char *fmt, va_list args)
+{
+	const bc_src_file *file = ctx ? ctx_file(ctx) : NULL;
+	if (file) {
+		size_t line;
+		size_t col;
+		ctx_get_start(&line, &col, ctx);
+		if (!append_text(
+				text, "%s:%zu:%zu: ", imm_str_read(src_file_path(file)), line,
+				col)) {
+			return false;
+		}
+	}
+
+	if (!append_text(
+			text, "%s%s:%s ", get_level_fmt(level), get_level_text(level),
+			get_fmt_off()) ||
+		!format_message(text, errnum, fmt, args)) {
+		return false;
+	}
+	return append_text(text, "\n");
+}
+
+/* Per-thread buffers, freed at thread exit by the text key destructor */
+static thread_local bc_error_text g_message;
+static thread_local bc_error_text g_scratch;
+static thread_local bool g_texts_tracked;
+
+static once_flag g_text_once = ONCE_FLAG_INIT;
+static tss_t g_text_key;
+
+static void free_texts(void *arg)
+{
+	(void)arg;
+	free(g_message.data);
+	free(g_scratch.data);
+	g_message = (bc_error_text){0};
+	g_scratch = (bc_error_text){0};
+	g_texts_tracked = false;
 }
 
-static inline void end_msg(int level)
+static void create_text_key(void)
 {
-	fprintf(stderr, "\n");
+	tss_create(&g_text_key, free_texts);
+}
+
+static inline void track_texts(void)
+{
+	if (g_texts_tracked) {
+		return;
+	}
+
+	call_once(&g_text_once, create_text_key);
+	g_texts_tracked = tss_set(g_text_key, &g_message) == thrd_success;
+}
+
+static inline bool format_json(
+	bc_error_text *text, int level, const bc_ctx *ctx, int errnum,
+	const char *fmt, va_list args, bool sarif)
+{
+	track_texts();
+	g_message.len = 0;
+	if (!reserve_text(&g_message, BC_ERROR_BUFFER_SIZE) ||
+		!format_message(&g_message, errnum, fmt, args)) {
+		return false;
+	}
+
+	if (sarif) {
+		if (!append_text(
+				text, ",{\"level\":\"%s\",\"message\":{\"text\":",
+				get_sarif_level(level)) ||
+			!append_json_str(text, g_message.data, g_message.len) ||
+			!append_text(text, "}")) {
+			return false;
+		}
+	} else if (
+		!append_text(
+			text, "{\"level\":\"%s\",\"message\":", get_level_text(level)) ||
+		!append_json_str(text, g_message.data, g_message.len)) {
+		return false;
+	}
+
+	const bc_src_file *file = ctx ? ctx_file(ctx) : NULL;
+	if (file) {
+		size_t line;
+		size_t col;
+		ctx_get_start(&line, &col, ctx);
+		const bc_imm_str *path = src_file_path(file);
+
+		if (sarif) {
+			if (!append_text(
+					text, ",\"locations\":[{\"physicalLocation\":{"
+						  "\"artifactLocation\":{\"uri\":") ||
+				!append_json_str(text, imm_str_read(path), imm_str_len(path)) ||
+				!append_text(
+					text,
+					"},\"region\":{\"startLine\":%zu,\"startColumn\":%zu}}}]",
+					line, col)) {
+				return false;
+			}
+		} else if (
+			!append_text(text, ",\"file\":") ||
+			!append_json_str(text, imm_str_read(path), imm_str_len(path)) ||
+			!append_text(text, ",\"line\":%zu,\"column\":%zu", line, col)) {
+			return false;
+		}
+	}
+	return append_text(text, "}\n");
+}
+
+static inline bool format_diag(
+	bc_error_text *text, int level, const bc_ctx *ctx, int errnum,
+	const char *fmt, va_list args)
+{
+	if (!reserve_text(text, BC_ERROR_BUFFER_SIZE)) {
+		return false;
+	}
+
+	switch (atomic_load_explicit(&g_output, memory_order_relaxed)) {
+	case BC_ERROR_OUTPUT_JSONL:
+		return format_json(text, level, ctx, errnum, fmt, args, false);
+	case BC_ERROR_OUTPUT_SARIF:
+		return format_json(text, level, ctx, errnum, fmt, args, true);
+	default:
+		return format_text(text, level, ctx, errnum, fmt, args);
+	}
+}
+
+/* Output Modes */
+
+#define BC_ERROR_SARIF_HEADER \
+	"{\"version\":\"2.1.0\",\"$schema\":" \
+	"\"https://json.schemastore.org/sarif-2.1.0.json\",\"runs\":[{\"tool\":" \
+	"{\"driver\":{\"name\":\"bcc\"}},\"results\":[\n"
+#define BC_ERROR_SARIF_FOOTER "]}]}\n"
+
+static bc_lock g_write_lock = BC_LOCK_INIT;
+static atomic_bool g_sarif_open;
+static bool g_sarif_first;
+
+static inline void write_all(const char *src, size_t len)
+{
+	while (len) {
+		ssize_t retval = write(STDERR_FILENO, src, len);
+		if (retval < 0 && errno == EINTR) {
+			continue;
+		} else if (retval <= 0) {
+			return;
+		}
+		src += retval;
+		len -= (size_t)retval;
+	}
+}
+
+/* Deferred Diagnostics */
+
+typedef struct bc_error_diag {
+	const bc_imm_str *path;
+	size_t offset;
+	int level;
+	size_t text_at;
+	size_t text_len;
+} bc_error_diag;
+
+typedef struct bc_error_queue {
+	struct bc_error_queue *next;
+	bc_lock lock;
+	bool closed;
+	bc_error_text text;
+	size_t len;
+	size_t cap;
+	bc_error_diag *diags;
+} bc_error_queue;
+
+typedef struct bc_error_entry {
+	const bc_imm_str *path;
+	size_t offset;
+	int level;
+	const char *text;
+	size_t text_len;
+} bc_error_entry;
+
+static atomic_bool g_deferred;
+static bc_lock g_queue_lock = BC_LOCK_INIT;
+static bc_error_queue *g_queues;
+
+static thread_local bc_error_queue *g_queue;
+
+static once_flag g_queue_once = ONCE_FLAG_INIT;
+static tss_t g_queue_key;
+
+static void close_queue(void *queue_ptr)
+{
+	bc_error_queue *queue = queue_ptr;
+	lock_acquire(&queue->lock);
+	queue->closed = true;
+	lock_release(&queue->lock);
+}
+
+static void create_queue_key(void)
+{
+	tss_create(&g_queue_key, close_queue);
+	atexit(error_flush);
+}
+
+static inline bc_error_queue *get_queue(void)
+{
+	if (g_queue) {
+		return g_queue;
+	}
+
+	call_once(&g_queue_once, create_queue_key);
+	bc_error_queue *queue = calloc(1, sizeof(*queue));
+	if (!queue) {
+		return NULL;
+	}
+	queue->lock = (bc_lock)BC_LOCK_INIT;
+
+	lock_acquire(&g_queue_lock);
+	queue->next = g_queues;
+	g_queues = queue;
+	lock_release(&g_queue_lock);
+
+	tss_set(g_queue_key, queue);
+	g_queue = queue;
+	return queue;
+}
+
+static inline bool reserve_diag(bc_error_queue *queue)
+{
+	if (queue->len < queue->cap) {
+		return true;
+	}
+
+	size_t cap = queue->cap ? queue->cap * 2 : BC_ERROR_DIAG_INIT_CAP;
+	bc_error_diag *diags = realloc(queue->diags, cap * sizeof(*diags));
+	if (!diags) {
+		return false;
+	}
+	queue->diags = diags;
+	queue->cap = cap;
+	return true;
+}
+
+static inline bool queue_diag(
+	const bc_ctx *ctx, int level, const char *text, size_t text_len)
+{
+	bc_error_queue *queue = get_queue();
+	if (!queue) {
+		return false;
+	}
+
+	bc_error_diag diag = {.level = level, .text_len = text_len};
+	const bc_src_file *file = ctx ? ctx_file(ctx) : NULL;
+	if (file) {
+		diag.path = src_file_path(file);
+		diag.offset =
+			(size_t)(ctx_at(ctx) - imm_str_read(src_file_text(file)));
+	}
+
+	lock_acquire(&queue->lock);
+	bool ok = reserve_diag(queue) && reserve_text(&queue->text, text_len);
+	if (ok) {
+		diag.text_at = queue->text.len;
+		memcpy(queue->text.data + queue->text.len, text, text_len);
+		queue->text.len += text_len;
+		queue->diags[queue->len++] = diag;
+	}
+	lock_release(&queue->lock);
+	return ok;
+}
+
+static int compare_entries(const void *a_ptr, const void *b_ptr)
+{
+	const bc_error_entry *a = a_ptr;
+	const bc_error_entry *b = b_ptr;
+	if (a->path != b->path) {
+		if (!a->path || !b->path) {
+			return a->path ? 1 : -1;
+		}
+
+		int cmp = strcmp(imm_str_read(a->path), imm_str_read(b->path));
+		if (cmp) {
+			return cmp;
+		}
+	}
+
+	if (a->offset != b->offset) {
+		return a->offset < b->offset ? -1 : 1;
+	} else if (a->level != b->level) {
+		return a->level < b->level ? -1 : 1;
+	}
+
+	int cmp = memcmp(
+		a->text, b->text,
+		a->text_len < b->text_len ? a->text_len : b->text_len);
+	if (cmp) {
+		return cmp;
+	}
+	return (a->text_len > b->text_len) - (a->text_len < b->text_len);
+}
+
+static inline void write_entries(const bc_error_entry *entries, size_t len)
+{
+	bool sarif = atomic_load_explicit(&g_sarif_open, memory_order_acquire);
+	if (sarif) {
+		lock_acquire(&g_write_lock);
+	}
+
+	struct iovec iov[BC_ERROR_IOV_MAX];
+	size_t at = 0;
+	while (at < len) {
+		int iov_len = 0;
+		for (; at < len && iov_len < BC_ERROR_IOV_MAX; at++, iov_len++) {
+			iov[iov_len].iov_base = (void *)entries[at].text;
+			iov[iov_len].iov_len = entries[at].text_len;
+		}
+
+		if (sarif && g_sarif_first && iov->iov_len) {
+			iov->iov_base = (char *)iov->iov_base + 1;
+			iov->iov_len--;
+			g_sarif_first = false;
+		}
+
+		struct iovec *next = iov;
+		while (iov_len) {
+			ssize_t retval = writev(STDERR_FILENO, next, iov_len);
+			if (retval < 0 && errno == EINTR) {
+				continue;
+			} else if (retval <= 0) {
+				at = len;
+				break;
+			}
+
+			size_t written = (size_t)retval;
+			while (iov_len && written >= next->iov_len) {
+				written -= next->iov_len;
+				next++;
+				iov_len--;
+			}
+			if (iov_len) {
+				next->iov_base = (char *)next->iov_base + written;
+				next->iov_len -= written;
+			}
+		}
+	}
+
+	if (sarif) {
+		lock_release(&g_write_lock);
+	}
+}
+
+static inline bc_error_queue *take_queues(size_t *len_dest)
+{
+	bc_error_queue *taken = NULL;
+	size_t len = 0;
+
+	lock_acquire(&g_queue_lock);
+	bc_error_queue **link = &g_queues;
+	while (*link) {
+		bc_error_queue *queue = *link;
+		bc_error_queue *copy = malloc(sizeof(*copy));
+
+		lock_acquire(&queue->lock);
+		bool closed = queue->closed;
+		if (copy) {
+			*copy = *queue;
+			copy->next = taken;
+			taken = copy;
+			len += queue->len;
+			queue->text = (bc_error_text){0};
+			queue->len = 0;
+			queue->cap = 0;
+			queue->diags = NULL;
+		}
+		lock_release(&queue->lock);
+
+		if (closed && copy) {
+			*link = queue->next;
+			free(queue->text.data);
+			free(queue->diags);
+			free(queue);
+		} else {
+			link = &queue->next;
+		}
+	}
+	lock_release(&g_queue_lock);
+
+	*len_dest = len;
+	return taken;
+}
+
+static inline void emit_v(
+	int level, const bc_ctx *ctx, int errnum, const char *fmt, va_list args)
+{
+	track_texts();
+	g_scratch.len = 0;
+	if (format_diag(&g_scratch, level, ctx, errnum, fmt, args) &&
+		(!atomic_load_explicit(&g_deferred, memory_order_relaxed) ||
+		 !queue_diag(ctx, level, g_scratch.data, g_scratch.len))) {
+		bc_error_entry entry = {
+			.text = g_scratch.data,
+			.text_len = g_scratch.len,
+		};
+		write_entries(&entry, 1);
+	}
+}
+
+static inline void emit(int level, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	emit_v(level, NULL, 0, fmt, args);
+	va_end(args);
+}
+
+/* Filtering */
+
+typedef struct bc_error_category {
+	const char *fmt;
+	uint64_t hash;
+	int level;
+	size_t count;
+	size_t suppressed;
+} bc_error_category;
+
+static atomic_uint g_suppressed_levels;
+static atomic_bool g_filtered;
+static bc_lock g_filter_lock = BC_LOCK_INIT;
+static bool g_dedup;
+static size_t g_limit;
+static size_t g_duplicates;
+
+static uint64_t *g_seen;
+static size_t g_seen_len;
+static size_t g_seen_cap;
+
+static bc_error_category *g_categories;
+static size_t g_categories_len;
+static size_t g_categories_cap;
+
+typedef struct bc_error_rule {
+	int level;
+	uint64_t hash;
+	char *fmt;
+	bc_loc loc;
+} bc_error_rule;
+
+static bc_error_rule *g_rules;
+static size_t g_rules_len;
+static size_t g_rules_cap;
+
+/* Formats are keyed by their text, not their address, so the same format
+ * from two translation units is one category for every filter */
+static inline uint64_t hash_fmt(const char *fmt)
+{
+	return hash_bytes(fmt, strlen(fmt));
+}
+
+static inline bool
+is_fmt_equal(const char *a, uint64_t a_hash, const char *b, uint64_t b_hash)
+{
+	return a_hash == b_hash && !strcmp(a, b);
+}
+
+static inline uint64_t hash_diag(int level, uint64_t fmt_hash, bc_loc loc)
+{
+	uint64_t key[] = {(uint64_t)level, fmt_hash, loc};
+	uint64_t hash = hash_bytes(key, sizeof(key));
+	return hash ? hash : 1;
+}
+
+static inline void place_seen(uint64_t *seen, size_t cap, uint64_t hash)
+{
+	size_t at = (size_t)hash & (cap - 1);
+	while (seen[at]) {
+		at = (at + 1) & (cap - 1);
+	}
+	seen[at] = hash;
+}
+
+static inline bool reserve_seen(void)
+{
+	if (2 * (g_seen_len + 1) <= g_seen_cap) {
+		return true;
+	}
+
+	size_t cap = g_seen_cap ? g_seen_cap * 2 : BC_ERROR_FILTER_INIT_CAP;
+	uint64_t *seen = calloc(cap, sizeof(*seen));
+	if (!seen) {
+		return false;
+	}
+
+	for (size_t i = 0; i < g_seen_cap; i++) {
+		if (g_seen[i]) {
+			place_seen(seen, cap, g_seen[i]);
+		}
+	}
+	free(g_seen);
+	g_seen = seen;
+	g_seen_cap = cap;
+	return true;
+}
+
+static inline bool insert_seen(uint64_t hash)
+{
+	if (!reserve_seen()) {
+		return true;
+	}
+
+	size_t at = (size_t)hash & (g_seen_cap - 1);
+	for (; g_seen[at]; at = (at + 1) & (g_seen_cap - 1)) {
+		if (g_seen[at] == hash) {
+			return false;
+		}
+	}
+	g_seen[at] = hash;
+	g_seen_len++;
+	return true;
+}
+
+static inline size_t hash_category(int level, uint64_t fmt_hash)
+{
+	return (size_t)hash_diag(level, fmt_hash, BC_LOC_NONE);
+}
+
+static inline void
+place_category(bc_error_category *categories, size_t cap, bc_error_category cat)
+{
+	size_t at = hash_category(cat.level, cat.hash) & (cap - 1);
+	while (categories[at].fmt) {
+		at = (at + 1) & (cap - 1);
+	}
+	categories[at] = cat;
+}
+
+static inline bool reserve_category(void)
+{
+	if (2 * (g_categories_len + 1) <= g_categories_cap) {
+		return true;
+	}
+
+	size_t cap =
+		g_categories_cap ? g_categories_cap * 2 : BC_ERROR_FILTER_INIT_CAP;
+	bc_error_category *categories = calloc(cap, sizeof(*categories));
+	if (!categories) {
+		return false;
+	}
+
+	for (size_t i = 0; i < g_categories_cap; i++) {
+		if (g_categories[i].fmt) {
+			place_category(categories, cap, g_categories[i]);
+		}
+	}
+	free(g_categories);
+	g_categories = categories;
+	g_categories_cap = cap;
+	return true;
+}
+
+static inline bc_error_category *
+get_category(int level, const char *fmt, uint64_t fmt_hash)
+{
+	if (!reserve_category()) {
+		return NULL;
+	}
+
+	size_t at = hash_category(level, fmt_hash) & (g_categories_cap - 1);
+	for (; g_categories[at].fmt; at = (at + 1) & (g_categories_cap - 1)) {
+		bc_error_category *cat = &g_categories[at];
+		if (cat->level == level &&
+			is_fmt_equal(cat->fmt, cat->hash, fmt, fmt_hash)) {
+			return cat;
+		}
+	}
+
+	g_categories[at] =
+		(bc_error_category){.fmt = fmt, .hash = fmt_hash, .level = level};
+	g_categories_len++;
+	return &g_categories[at];
+}
+
+static inline bool is_rule_equal(
+	const bc_error_rule *rule, int level, const char *fmt, uint64_t hash,
+	bc_loc loc)
+{
+	if (rule->fmt) {
+		return fmt && rule->level == level &&
+			   is_fmt_equal(rule->fmt, rule->hash, fmt, hash);
+	}
+	return !fmt && rule->loc == loc;
+}
+
+static inline bool
+is_muted(int level, const bc_ctx *ctx, const char *fmt, uint64_t fmt_hash)
+{
+	for (size_t i = 0; i < g_rules_len; i++) {
+		const bc_error_rule *rule = &g_rules[i];
+		if (!rule->fmt) {
+			if (ctx && rule->loc == ctx->start) {
+				return true;
+			}
+			continue;
+		} else if (is_rule_equal(rule, level, fmt, fmt_hash, BC_LOC_NONE)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline bool is_level_valid(int level)
+{
+	return level >= 0 && level <= BC_ERROR_FATAL;
+}
+
+static inline bool is_level_enabled(int level)
+{
+	if (!is_level_valid(level)) {
+		return true;
+	}
+
+	unsigned levels =
+		atomic_load_explicit(&g_suppressed_levels, memory_order_relaxed);
+	return !(levels & (1u << level));
+}
+
+static inline bool should_report(int level, const bc_ctx *ctx, const char *fmt)
+{
+	if (!is_level_enabled(level)) {
+		return false;
+	} else if (!atomic_load_explicit(&g_filtered, memory_order_relaxed)) {
+		return true;
+	}
+
+	uint64_t fmt_hash = hash_fmt(fmt);
+	lock_acquire(&g_filter_lock);
+	bool ok = !is_muted(level, ctx, fmt, fmt_hash);
+	if (ok && g_dedup && ctx && ctx->start != BC_LOC_NONE &&
+		!insert_seen(hash_diag(level, fmt_hash, ctx->start))) {
+		g_duplicates++;
+		ok = false;
+	}
+
+	bc_error_category *cat =
+		ok && g_limit ? get_category(level, fmt, fmt_hash) : NULL;
+	if (cat && cat->count >= g_limit) {
+		cat->suppressed++;
+		ok = false;
+	} else if (cat) {
+		cat->count++;
+	}
+	lock_release(&g_filter_lock);
+	return ok;
+}
+
+/* Counts are taken under the filter lock and reported after releasing it */
+static inline void report_suppressed(void)
+{
+	if (!atomic_load_explicit(&g_filtered, memory_order_relaxed)) {
+		return;
+	}
+
+	lock_acquire(&g_filter_lock);
+	size_t len = 0;
+	for (size_t i = 0; i < g_categories_cap; i++) {
+		len += g_categories[i].fmt && g_categories[i].suppressed;
+	}
+
+	bc_error_category *taken = len ? malloc(len * sizeof(*taken)) : NULL;
+	len = 0;
+	for (size_t i = 0; taken && i < g_categories_cap; i++) {
+		bc_error_category *cat = &g_categories[i];
+		if (cat->fmt && cat->suppressed) {
+			taken[len++] = *cat;
+			cat->suppressed = 0;
+		}
+	}
+
+	size_t duplicates = g_duplicates;
+	g_duplicates = 0;
+	lock_release(&g_filter_lock);
+
+	for (size_t i = 0; i < len; i++) {
+		emit(
+			BC_ERROR_NOTE, "%zu more %s diagnostics like \"%s\" suppressed",
+			taken[i].suppressed, get_level_text(taken[i].level), taken[i].fmt);
+	}
+	free(taken);
+
+	if (duplicates) {
+		emit(
+			BC_ERROR_NOTE, "%zu duplicate diagnostics suppressed", duplicates);
+	}
+}
+
+static inline void update_filter(void)
+{
+	atomic_store_explicit(
+		&g_filtered, g_dedup || g_limit || g_rules_len, memory_order_relaxed);
+}
+
+static inline bool reserve_rule(size_t *size_dest)
+{
+	if (g_rules_len < g_rules_cap) {
+		return true;
+	}
+
+	size_t cap = g_rules_cap ? g_rules_cap * 2 : BC_ERROR_FILTER_INIT_CAP;
+	bc_error_rule *rules = realloc(g_rules, cap * sizeof(*rules));
+	if (!rules) {
+		*size_dest = cap * sizeof(*rules);
+		return false;
+	}
+	g_rules = rules;
+	g_rules_cap = cap;
+	return true;
+}
+
+static inline void set_rule(bc_error_rule rule, bool suppressed)
+{
+	call_once(&g_queue_once, create_queue_key);
+
+	lock_acquire(&g_filter_lock);
+	size_t at = 0;
+	while (at < g_rules_len &&
+		   !is_rule_equal(
+			   &g_rules[at], rule.level, rule.fmt, rule.hash, rule.loc)) {
+		at++;
+	}
+
+	bool found = at < g_rules_len;
+	size_t fail_size = 0;
+	if (suppressed && !found) {
+		if (reserve_rule(&fail_size)) {
+			g_rules[g_rules_len++] = rule;
+			rule.fmt = NULL;
+		}
+	} else if (!suppressed && found) {
+		free(g_rules[at].fmt);
+		g_rules[at] = g_rules[--g_rules_len];
+	}
+	update_filter();
+	lock_release(&g_filter_lock);
+
+	/* Report outside the filter lock, error_alloc flushes and exits */
+	free(rule.fmt);
+	if (fail_size) {
+		error_alloc(fail_size);
+	}
+}
+
+void error_suppress_fmt(int level, const char *fmt, bool suppressed)
+{
+	if (!is_level_valid(level) || level == BC_ERROR_FATAL || !fmt) {
+		return;
+	}
+
+	size_t len = strlen(fmt) + 1;
+	char *copy = malloc(len);
+	if (!copy) {
+		error_alloc(len);
+		return;
+	}
+
+	memcpy(copy, fmt, len);
+	set_rule(
+		(bc_error_rule){.level = level, .hash = hash_fmt(fmt), .fmt = copy},
+		suppressed);
+}
+
+void error_suppress_at(const bc_ctx *ctx, bool suppressed)
+{
+	if (!ctx || ctx->start == BC_LOC_NONE) {
+		return;
+	}
+	set_rule((bc_error_rule){.loc = ctx->start}, suppressed);
+}
+
+void error_suppress(int level, bool suppressed)
+{
+	if (!is_level_valid(level) || level == BC_ERROR_FATAL) {
+		return;
+	} else if (suppressed) {
+		atomic_fetch_or_explicit(
+			&g_suppressed_levels, 1u << level, memory_order_relaxed);
+	} else {
+		atomic_fetch_and_explicit(
+			&g_suppressed_levels, ~(1u << level), memory_order_relaxed);
+	}
+}
+
+bool error_enabled(int level)
+{
+	return is_level_enabled(level);
+}
+
+void error_set_dedup(bool dedup)
+{
+	call_once(&g_queue_once, create_queue_key);
+
+	lock_acquire(&g_filter_lock);
+	g_dedup = dedup;
+	update_filter();
+	lock_release(&g_filter_lock);
+}
+
+void error_set_limit(size_t limit)
+{
+	call_once(&g_queue_once, create_queue_key);
+
+	lock_acquire(&g_filter_lock);
+	g_limit = limit;
+	update_filter();
+	lock_release(&g_filter_lock);
+}
+
+void error_flush(void)
+{
+	report_suppressed();
+
+	size_t len;
+	bc_error_queue *taken = take_queues(&len);
+	bc_error_entry *entries = malloc(len * sizeof(*entries));
+
+	size_t at = 0;
+	for (bc_error_queue *queue = taken; queue; queue = queue->next) {
+		for (size_t i = 0; i < queue->len; i++) {
+			const bc_error_diag *diag = &queue->diags[i];
+			bc_error_entry entry = {
+				diag->path, diag->offset, diag->level,
+				queue->text.data + diag->text_at, diag->text_len,
+			};
+			if (entries) {
+				entries[at++] = entry;
+			} else {
+				write_entries(&entry, 1);
+			}
+		}
+	}
+
+	if (entries) {
+		qsort(entries, len, sizeof(*entries), compare_entries);
+		write_entries(entries, len);
+		free(entries);
+	}
+
+	while (taken) {
+		bc_error_queue *next = taken->next;
+		free(taken->text.data);
+		free(taken->diags);
+		free(taken);
+		taken = next;
+	}
+}
+
+void error_defer(bool deferred)
+{
+	if (!deferred) {
+		error_flush();
+	}
+	atomic_store_explicit(&g_deferred, deferred, memory_order_relaxed);
+}
+
+static once_flag g_output_once = ONCE_FLAG_INIT;
+
+static void close_output(void)
+{
+	error_set_output(BC_ERROR_OUTPUT_TEXT);
+}
+
+static void register_output(void)
+{
+	atexit(close_output);
+}
+
+void error_set_output(int output)
+{
+	error_flush();
+	call_once(&g_output_once, register_output);
+
+	lock_acquire(&g_write_lock);
+	bool sarif = atomic_load_explicit(&g_sarif_open, memory_order_relaxed);
+	if (sarif && output != BC_ERROR_OUTPUT_SARIF) {
+		write_all(BC_ERROR_SARIF_FOOTER, strlen(BC_ERROR_SARIF_FOOTER));
+		atomic_store_explicit(&g_sarif_open, false, memory_order_release);
+	} else if (!sarif && output == BC_ERROR_OUTPUT_SARIF) {
+		write_all(BC_ERROR_SARIF_HEADER, strlen(BC_ERROR_SARIF_HEADER));
+		g_sarif_first = true;
+		atomic_store_explicit(&g_sarif_open, true, memory_order_release);
+	}
+	atomic_store_explicit(&g_output, output, memory_order_relaxed);
+	lock_release(&g_write_lock);
+}
+
+/* Reporting */
+
+static inline void report_v(
+	int level, const bc_ctx *ctx, int errnum, const char *fmt, va_list args)
+{
+	if (level == BC_ERROR_FATAL || should_report(level, ctx, fmt)) {
+		emit_v(level, ctx, errnum, fmt, args);
+	}
+
 	if (level == BC_ERROR_FATAL) {
+		error_flush();
 		exit(EXIT_FAILURE);
 	}
 }
@@ -81,32 +1194,24 @@ void error_msg(int level, const char *fmt, ...)
 {
 	va_list args;
 	va_start(args, fmt);
-	begin_msg_v(level, fmt, args);
+	report_v(level, NULL, 0, fmt, args);
+	va_end(args);
+}
+
+void error_at(int level, const bc_ctx *ctx, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	report_v(level, ctx, 0, fmt, args);
 	va_end(args);
-	end_msg(level);
 }
 
 void error_sys(int level, int errnum, const char *fmt, ...)
 {
-	char buf[BC_ERROR_BUFFER_SIZE];
-#ifdef _GNU_SOURCE
-	const char *msg = strerror_r(errnum, buf, sizeof(buf));
-#else
-	switch (strerror_r(errnum, buf, sizeof(buf))) {
-	case EINVAL:
-		snprintf(buf, sizeof(buf), "strerror_r: Unknown errno %d", errnum);
-		break;
-	case ERANGE:
-		snprintf(
-			buf, sizeof(buf), "strerror_r: Insufficient error buffer size %zu",
-			sizeof(buf));
-		break;
-	default:
-		break;
-	}
-	const char *msg = buf;
-#endif
-	fprintf(stderr, "%s", msg);
+	va_list args;
+	va_start(args, fmt);
+	report_v(level, NULL, errnum, fmt, args);
+	va_end(args);
 }
 
 void error_alloc(size_t size)
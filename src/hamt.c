@@ -0,0 +1 @@
+#include "hamt/hamt.0.0.h"
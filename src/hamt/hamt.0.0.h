@@ -0,0 +1,584 @@
+#include "hamt.h"
+#include "hash.h"
+#include "imm_str.h"
+#include "rc.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Constants */
+
+enum {
+	BC_HAMT_BITS = 5,
+	BC_HAMT_MASK = (1 << BC_HAMT_BITS) - 1,
+	BC_HAMT_HASH_BITS = 64,
+	BC_HAMT_DEPTH_MAX = BC_HAMT_HASH_BITS / BC_HAMT_BITS + 2,
+};
+
+/* Nodes */
+
+typedef struct bc_hamt_entry {
+	uint64_t hash;
+	const bc_imm_str *key;
+	const void *value;
+} bc_hamt_entry;
+
+typedef struct bc_hamt {
+	uint32_t datamap;
+	uint32_t nodemap;
+	bc_hamt_entry entries[];
+} bc_hamt;
+
+const bc_imm_str *hamt_entry_key(const bc_hamt_entry *entry)
+{
+	return entry->key;
+}
+
+const void *hamt_entry_value(const bc_hamt_entry *entry)
+{
+	return entry->value;
+}
+
+static inline bool is_collision(unsigned shift)
+{
+	return shift >= BC_HAMT_HASH_BITS;
+}
+
+static inline uint32_t get_hash_bit(uint64_t hash, unsigned shift)
+{
+	return UINT32_C(1) << ((hash >> shift) & BC_HAMT_MASK);
+}
+
+static inline unsigned get_bit_index(uint32_t map, uint32_t bit)
+{
+	return (unsigned)__builtin_popcount(map & (bit - 1));
+}
+
+static inline unsigned get_entry_count(const bc_hamt *node, unsigned shift)
+{
+	if (is_collision(shift)) {
+		return node->datamap;
+	}
+	return (unsigned)__builtin_popcount(node->datamap);
+}
+
+static inline unsigned get_child_count(const bc_hamt *node)
+{
+	return (unsigned)__builtin_popcount(node->nodemap);
+}
+
+static inline bc_hamt **get_children(const bc_hamt *node)
+{
+	return (bc_hamt **)(node->entries + __builtin_popcount(node->datamap));
+}
+
+static inline size_t get_node_size(unsigned entry_count, unsigned child_count)
+{
+	return sizeof(bc_hamt) + entry_count * sizeof(bc_hamt_entry) +
+		   child_count * sizeof(bc_hamt *);
+}
+
+static void hamt_visit(const void *hamt_ptr, void (*visitor)(const void *))
+{
+	const bc_hamt *node = hamt_ptr;
+	unsigned entry_count = get_entry_count(node, 0);
+	for (unsigned i = 0; i < entry_count; i++) {
+		visitor(node->entries[i].key);
+		visitor(node->entries[i].value);
+	}
+
+	bc_hamt **children = get_children(node);
+	unsigned child_count = get_child_count(node);
+	for (unsigned i = 0; i < child_count; i++) {
+		visitor(children[i]);
+	}
+}
+
+static void
+collision_visit(const void *hamt_ptr, void (*visitor)(const void *))
+{
+	const bc_hamt *node = hamt_ptr;
+	for (uint32_t i = 0; i < node->datamap; i++) {
+		visitor(node->entries[i].key);
+		visitor(node->entries[i].value);
+	}
+}
+
+static inline bc_hamt *
+alloc_node(unsigned entry_count, unsigned child_count, unsigned shift)
+{
+	return rc_alloc(
+		get_node_size(entry_count, child_count),
+		is_collision(shift) ? collision_visit : hamt_visit);
+}
+
+/* Entries */
+
+static inline bool init_entry(
+	bc_hamt_entry *entry, uint64_t hash, const char *key, size_t len,
+	const void *value)
+{
+	const bc_imm_str *key_str = imm_str_intern_n(key, len);
+	if (!key_str) {
+		rc_unref(value);
+		return false;
+	}
+
+	entry->hash = hash;
+	entry->key = key_str;
+	entry->value = value;
+	return true;
+}
+
+static inline void release_entry(const bc_hamt_entry *entry)
+{
+	rc_unref(entry->key);
+	rc_unref(entry->value);
+}
+
+static inline bool is_entry_match(
+	const bc_hamt_entry *entry, uint64_t hash, const char *key, size_t len)
+{
+	return entry->hash == hash && imm_str_len(entry->key) == len &&
+		   !memcmp(imm_str_read(entry->key), key, len);
+}
+
+static inline bc_hamt_entry *find_collision(
+	const bc_hamt *node, uint64_t hash, const char *key, size_t len)
+{
+	for (uint32_t i = 0; i < node->datamap; i++) {
+		if (is_entry_match(&node->entries[i], hash, key, len)) {
+			return (bc_hamt_entry *)&node->entries[i];
+		}
+	}
+	return NULL;
+}
+
+static inline bc_hamt_entry *
+find_entry(const bc_hamt *node, uint64_t hash, const char *key, size_t len)
+{
+	for (unsigned shift = 0; node; shift += BC_HAMT_BITS) {
+		if (is_collision(shift)) {
+			return find_collision(node, hash, key, len);
+		}
+
+		uint32_t bit = get_hash_bit(hash, shift);
+		if (node->datamap & bit) {
+			const bc_hamt_entry *entry =
+				&node->entries[get_bit_index(node->datamap, bit)];
+			if (is_entry_match(entry, hash, key, len)) {
+				return (bc_hamt_entry *)entry;
+			}
+			return NULL;
+		} else if (!(node->nodemap & bit)) {
+			return NULL;
+		}
+		node = get_children(node)[get_bit_index(node->nodemap, bit)];
+	}
+	return NULL;
+}
+
+const bc_hamt_entry *
+hamt_find(const bc_hamt *hamt, const char *key, size_t len)
+{
+	return find_entry(hamt, hash_bytes(key, len), key, len);
+}
+
+const bc_hamt_entry *
+hamt_find_str(const bc_hamt *hamt, const bc_imm_str *key)
+{
+	const char *key_src = imm_str_read(key);
+	size_t key_len = imm_str_len(key);
+	uint64_t hash = imm_str_hash(key);
+	for (unsigned shift = 0; hamt; shift += BC_HAMT_BITS) {
+		if (is_collision(shift)) {
+			return find_collision(hamt, hash, key_src, key_len);
+		}
+
+		uint32_t bit = get_hash_bit(hash, shift);
+		if (hamt->datamap & bit) {
+			const bc_hamt_entry *entry =
+				&hamt->entries[get_bit_index(hamt->datamap, bit)];
+			if (entry->key == key ||
+				is_entry_match(entry, hash, key_src, key_len)) {
+				return entry;
+			}
+			return NULL;
+		} else if (!(hamt->nodemap & bit)) {
+			return NULL;
+		}
+		hamt = get_children(hamt)[get_bit_index(hamt->nodemap, bit)];
+	}
+	return NULL;
+}
+
+/* Insertion */
+
+static inline bc_hamt *pair_node(
+	bc_hamt_entry **entry_p, const bc_hamt_entry *prev,
+	const bc_hamt_entry *next, unsigned shift)
+{
+	unsigned top = shift;
+	while (!is_collision(top) &&
+		   get_hash_bit(prev->hash, top) == get_hash_bit(next->hash, top)) {
+		top += BC_HAMT_BITS;
+	}
+
+	bc_hamt *node = alloc_node(2, 0, top);
+	if (!node) {
+		release_entry(next);
+		return NULL;
+	}
+
+	rc_ref(prev->key);
+	rc_ref(prev->value);
+	node->nodemap = 0;
+	if (is_collision(top)) {
+		node->datamap = 2;
+		node->entries[0] = *prev;
+		node->entries[1] = *next;
+		*entry_p = &node->entries[1];
+	} else {
+		uint32_t prev_bit = get_hash_bit(prev->hash, top);
+		uint32_t next_bit = get_hash_bit(next->hash, top);
+		bool is_next_last = prev_bit < next_bit;
+		node->datamap = prev_bit | next_bit;
+		node->entries[!is_next_last] = *prev;
+		node->entries[is_next_last] = *next;
+		*entry_p = &node->entries[is_next_last];
+	}
+
+	while (top != shift) {
+		top -= BC_HAMT_BITS;
+		bc_hamt *parent = alloc_node(0, 1, top);
+		if (!parent) {
+			rc_unref(node);
+			return NULL;
+		}
+
+		parent->datamap = 0;
+		parent->nodemap = get_hash_bit(next->hash, top);
+		get_children(parent)[0] = node;
+		node = parent;
+	}
+	return node;
+}
+
+static inline bc_hamt_entry *
+insert_entry(bc_hamt **slot, const bc_hamt_entry *next, uint32_t bit)
+{
+	bc_hamt *node = *slot;
+	unsigned entry_count = get_entry_count(node, 0);
+	unsigned child_count = get_child_count(node);
+
+	node = rc_resize(node, get_node_size(entry_count + 1, child_count));
+	*slot = node;
+	if (!node) {
+		release_entry(next);
+		return NULL;
+	}
+
+	unsigned index = get_bit_index(node->datamap, bit);
+	memmove(
+		&node->entries[index + 1], &node->entries[index],
+		(entry_count - index) * sizeof(bc_hamt_entry) +
+			child_count * sizeof(bc_hamt *));
+	node->entries[index] = *next;
+	node->datamap |= bit;
+	return &node->entries[index];
+}
+
+static inline bc_hamt_entry *split_entry(
+	bc_hamt **slot, const bc_hamt_entry *next, uint32_t bit, unsigned shift)
+{
+	bc_hamt *node = rc_edit(*slot);
+	*slot = node;
+	if (!node) {
+		release_entry(next);
+		return NULL;
+	}
+
+	unsigned entry_count = get_entry_count(node, shift);
+	unsigned child_count = get_child_count(node);
+	unsigned index = get_bit_index(node->datamap, bit);
+	unsigned child_index = get_bit_index(node->nodemap, bit);
+
+	bc_hamt_entry *entry;
+	bc_hamt_entry prev = node->entries[index];
+	bc_hamt *child = pair_node(&entry, &prev, next, shift + BC_HAMT_BITS);
+	if (!child) {
+		return NULL;
+	}
+
+	bc_hamt **children = get_children(node);
+	bc_hamt **dest = (bc_hamt **)(node->entries + entry_count - 1);
+	memmove(
+		&node->entries[index], &node->entries[index + 1],
+		(entry_count - index - 1) * sizeof(bc_hamt_entry));
+	memmove(dest, children, child_index * sizeof(bc_hamt *));
+	memmove(
+		dest + child_index + 1, children + child_index,
+		(child_count - child_index) * sizeof(bc_hamt *));
+	dest[child_index] = child;
+	node->datamap &= ~bit;
+	node->nodemap |= bit;
+	release_entry(&prev);
+
+	node = rc_resize(node, get_node_size(entry_count - 1, child_count + 1));
+	*slot = node;
+	if (!node) {
+		return NULL;
+	}
+	return entry;
+}
+
+static inline bc_hamt_entry *define_collision(
+	bc_hamt **slot, const char *key, size_t len, uint64_t hash, void *value)
+{
+	bc_hamt *node = *slot;
+	uint32_t count = node->datamap;
+	for (uint32_t i = 0; i < count; i++) {
+		if (is_entry_match(&node->entries[i], hash, key, len)) {
+			node = rc_edit(node);
+			*slot = node;
+			if (!node) {
+				rc_unref(value);
+				return NULL;
+			}
+
+			rc_unref(node->entries[i].value);
+			node->entries[i].value = value;
+			return &node->entries[i];
+		}
+	}
+
+	bc_hamt_entry next;
+	if (!init_entry(&next, hash, key, len, value)) {
+		return NULL;
+	}
+
+	node = rc_resize(node, get_node_size(count + 1, 0));
+	*slot = node;
+	if (!node) {
+		release_entry(&next);
+		return NULL;
+	}
+
+	node->entries[count] = next;
+	node->datamap = count + 1;
+	return &node->entries[count];
+}
+
+static inline bc_hamt_entry *define_entry(
+	bc_hamt **slot, const char *key, size_t len, uint64_t hash, void *value)
+{
+	for (unsigned shift = 0;; shift += BC_HAMT_BITS) {
+		bc_hamt *node = *slot;
+		if (is_collision(shift)) {
+			return define_collision(slot, key, len, hash, value);
+		}
+
+		uint32_t bit = get_hash_bit(hash, shift);
+		if (node->nodemap & bit) {
+			node = rc_edit(node);
+			*slot = node;
+			if (!node) {
+				rc_unref(value);
+				return NULL;
+			}
+			slot = &get_children(node)[get_bit_index(node->nodemap, bit)];
+			continue;
+		}
+
+		bc_hamt_entry *entry = NULL;
+		if (node->datamap & bit) {
+			entry = &node->entries[get_bit_index(node->datamap, bit)];
+			if (is_entry_match(entry, hash, key, len)) {
+				node = rc_edit(node);
+				*slot = node;
+				if (!node) {
+					rc_unref(value);
+					return NULL;
+				}
+
+				entry = &node->entries[get_bit_index(node->datamap, bit)];
+				rc_unref(entry->value);
+				entry->value = value;
+				return entry;
+			}
+		}
+
+		bc_hamt_entry next;
+		if (!init_entry(&next, hash, key, len, value)) {
+			return NULL;
+		} else if (entry) {
+			return split_entry(slot, &next, bit, shift);
+		}
+		return insert_entry(slot, &next, bit);
+	}
+}
+
+const bc_hamt_entry *hamt_define(
+	const bc_hamt **hamt_p, const char *key, size_t len, void *value)
+{
+	uint64_t hash = hash_bytes(key, len);
+	if (*hamt_p) {
+		bc_hamt_entry *entry =
+			define_entry((bc_hamt **)hamt_p, key, len, hash, value);
+		if (!entry) {
+			rc_unref(*hamt_p);
+			*hamt_p = NULL;
+		}
+		return entry;
+	}
+
+	bc_hamt_entry next;
+	if (!init_entry(&next, hash, key, len, value)) {
+		return NULL;
+	}
+
+	bc_hamt *node = alloc_node(1, 0, 0);
+	if (!node) {
+		release_entry(&next);
+		return NULL;
+	}
+
+	node->datamap = get_hash_bit(hash, 0);
+	node->nodemap = 0;
+	node->entries[0] = next;
+	*hamt_p = node;
+	return &node->entries[0];
+}
+
+/* Removal */
+
+static inline bool remove_entry(
+	bc_hamt **slot, unsigned index, uint32_t bit, unsigned shift)
+{
+	bc_hamt *node = *slot;
+	unsigned entry_count = get_entry_count(node, shift);
+	unsigned child_count = get_child_count(node);
+
+	release_entry(&node->entries[index]);
+	memmove(
+		&node->entries[index], &node->entries[index + 1],
+		(entry_count - index - 1) * sizeof(bc_hamt_entry) +
+			child_count * sizeof(bc_hamt *));
+	if (is_collision(shift)) {
+		node->datamap--;
+	} else {
+		node->datamap &= ~bit;
+	}
+
+	node = rc_resize(node, get_node_size(entry_count - 1, child_count));
+	*slot = node;
+	return node != NULL;
+}
+
+static inline bool inline_child(bc_hamt **slot, uint32_t bit, unsigned shift)
+{
+	bc_hamt *node = *slot;
+	unsigned entry_count = get_entry_count(node, shift);
+	unsigned child_count = get_child_count(node);
+	unsigned index = get_bit_index(node->datamap, bit);
+	unsigned child_index = get_bit_index(node->nodemap, bit);
+
+	bc_hamt *child = get_children(node)[child_index];
+	bc_hamt_entry entry = child->entries[0];
+
+	node = rc_resize(node, get_node_size(entry_count + 1, child_count - 1));
+	*slot = node;
+	if (!node) {
+		return false;
+	}
+
+	bc_hamt **children = (bc_hamt **)(node->entries + entry_count);
+	bc_hamt **dest = (bc_hamt **)(node->entries + entry_count + 1);
+	memmove(
+		dest + child_index, children + child_index + 1,
+		(child_count - child_index - 1) * sizeof(bc_hamt *));
+	memmove(dest, children, child_index * sizeof(bc_hamt *));
+	memmove(
+		&node->entries[index + 1], &node->entries[index],
+		(entry_count - index) * sizeof(bc_hamt_entry));
+	node->entries[index] = entry;
+	node->datamap |= bit;
+	node->nodemap &= ~bit;
+
+	child->datamap = 0;
+	rc_unref(child);
+	return true;
+}
+
+static inline bool
+delete_entry(bc_hamt **slot, uint64_t hash, const char *key, size_t len)
+{
+	bc_hamt **path[BC_HAMT_DEPTH_MAX];
+	uint32_t bits[BC_HAMT_DEPTH_MAX];
+	unsigned depth = 0;
+	for (unsigned shift = 0;; shift += BC_HAMT_BITS) {
+		bc_hamt *node = rc_edit(*slot);
+		*slot = node;
+		if (!node) {
+			return false;
+		}
+		path[depth] = slot;
+
+		if (is_collision(shift)) {
+			unsigned index = 0;
+			while (!is_entry_match(&node->entries[index], hash, key, len)) {
+				index++;
+			}
+			if (!remove_entry(slot, index, 0, shift)) {
+				return false;
+			}
+			break;
+		}
+
+		uint32_t bit = get_hash_bit(hash, shift);
+		if (node->datamap & bit) {
+			unsigned index = get_bit_index(node->datamap, bit);
+			if (!remove_entry(slot, index, bit, shift)) {
+				return false;
+			}
+			break;
+		}
+
+		bits[depth++] = bit;
+		slot = &get_children(node)[get_bit_index(node->nodemap, bit)];
+	}
+
+	for (; depth; depth--) {
+		bc_hamt *node = *path[depth];
+		unsigned shift = depth * BC_HAMT_BITS;
+		if (node->nodemap || get_entry_count(node, shift) != 1) {
+			break;
+		}
+
+		shift -= BC_HAMT_BITS;
+		if (!inline_child(path[depth - 1], bits[depth - 1], shift)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void hamt_delete(const bc_hamt **hamt_p, const char *key, size_t len)
+{
+	uint64_t hash = hash_bytes(key, len);
+	if (!find_entry(*hamt_p, hash, key, len)) {
+		return;
+	} else if (!delete_entry((bc_hamt **)hamt_p, hash, key, len)) {
+		rc_unref(*hamt_p);
+		*hamt_p = NULL;
+		return;
+	}
+
+	const bc_hamt *root = *hamt_p;
+	if (!root->datamap && !root->nodemap) {
+		rc_unref(root);
+		*hamt_p = NULL;
+	}
+}
@@ -0,0 +1 @@
+#include "hash/hash.0.0.h"
@@ -0,0 +1,235 @@
+#include "hash.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_HASH_SIMD
+#	if defined(__x86_64__) && defined(__GNUC__)
+#		define BC_HASH_SIMD 1
+#	else
+#		define BC_HASH_SIMD 0
+#	endif
+#endif
+
+#if BC_HASH_SIMD
+#	include <immintrin.h>
+#endif
+
+/* Constants */
+
+#define BC_HASH_PRIME_1 UINT64_C(0x9e3779b185ebca87)
+#define BC_HASH_PRIME_2 UINT64_C(0xc2b2ae3d27d4eb4f)
+#define BC_HASH_PRIME_3 UINT64_C(0x165667b19e3779f9)
+
+enum {
+	BC_HASH_LANES = 4,
+	BC_HASH_STRIPE = BC_HASH_LANES * sizeof(uint64_t),
+};
+
+static const uint64_t g_lane_keys[BC_HASH_LANES] = {
+	UINT64_C(0xbe4ba423396cfeb8),
+	UINT64_C(0x1cad21f72c81017c),
+	UINT64_C(0xdb979083e96dd4de),
+	UINT64_C(0x1f67b3b7a4a44072),
+};
+
+/* Mixing */
+
+static inline uint64_t read_word(const unsigned char *src)
+{
+	uint64_t word;
+	memcpy(&word, src, sizeof(word));
+	return word;
+}
+
+static inline uint64_t rotate_word(uint64_t word, unsigned bits)
+{
+	return (word << bits) | (word >> (64 - bits));
+}
+
+static inline uint64_t mix_word(uint64_t word)
+{
+	word ^= word >> 33;
+	word *= BC_HASH_PRIME_2;
+	word ^= word >> 29;
+	word *= BC_HASH_PRIME_3;
+	word ^= word >> 32;
+	return word;
+}
+
+static inline uint64_t merge_word(uint64_t hash, uint64_t word)
+{
+	hash ^= mix_word(word * BC_HASH_PRIME_2);
+	return rotate_word(hash, 27) * BC_HASH_PRIME_1 + BC_HASH_PRIME_3;
+}
+
+/* Stripes */
+
+typedef void (*bc_hash_accumulate)(
+	uint64_t *acc, const unsigned char *src, size_t count);
+
+static const uint64_t g_lane_seeds[BC_HASH_LANES] = {
+	BC_HASH_PRIME_1,
+	BC_HASH_PRIME_2,
+	BC_HASH_PRIME_3,
+	BC_HASH_PRIME_1 ^ BC_HASH_PRIME_2,
+};
+
+static void
+accumulate_scalar(uint64_t *acc, const unsigned char *src, size_t count)
+{
+	memcpy(acc, g_lane_seeds, sizeof(g_lane_seeds));
+	for (; count; count--, src += BC_HASH_STRIPE) {
+		for (size_t i = 0; i < BC_HASH_LANES; i++) {
+			uint64_t word = read_word(src + i * sizeof(uint64_t));
+			uint64_t key = word ^ g_lane_keys[i];
+			acc[i] += word + (key & UINT32_MAX) * (key >> 32);
+		}
+	}
+}
+
+#if BC_HASH_SIMD
+__attribute__((target("sse2"))) static inline __m128i
+accumulate_sse2_lanes(__m128i acc, __m128i word, __m128i lane_key)
+{
+	__m128i key = _mm_xor_si128(word, lane_key);
+	__m128i product = _mm_mul_epu32(key, _mm_srli_epi64(key, 32));
+	return _mm_add_epi64(acc, _mm_add_epi64(word, product));
+}
+
+__attribute__((target("sse2"))) static void
+accumulate_sse2(uint64_t *acc, const unsigned char *src, size_t count)
+{
+	__m128i acc_lo = _mm_loadu_si128((const __m128i *)g_lane_seeds);
+	__m128i acc_hi = _mm_loadu_si128((const __m128i *)(g_lane_seeds + 2));
+	__m128i key_lo = _mm_loadu_si128((const __m128i *)g_lane_keys);
+	__m128i key_hi = _mm_loadu_si128((const __m128i *)(g_lane_keys + 2));
+
+	for (; count; count--, src += BC_HASH_STRIPE) {
+		__m128i word_lo = _mm_loadu_si128((const __m128i *)src);
+		__m128i word_hi = _mm_loadu_si128((const __m128i *)(src + 16));
+		acc_lo = accumulate_sse2_lanes(acc_lo, word_lo, key_lo);
+		acc_hi = accumulate_sse2_lanes(acc_hi, word_hi, key_hi);
+	}
+
+	_mm_storeu_si128((__m128i *)acc, acc_lo);
+	_mm_storeu_si128((__m128i *)(acc + 2), acc_hi);
+}
+
+__attribute__((target("avx2"))) static void
+accumulate_avx2(uint64_t *acc, const unsigned char *src, size_t count)
+{
+	__m256i acc_all = _mm256_loadu_si256((const __m256i *)g_lane_seeds);
+	__m256i lane_key = _mm256_loadu_si256((const __m256i *)g_lane_keys);
+
+	for (; count; count--, src += BC_HASH_STRIPE) {
+		__m256i word = _mm256_loadu_si256((const __m256i *)src);
+		__m256i key = _mm256_xor_si256(word, lane_key);
+		__m256i product = _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32));
+		acc_all = _mm256_add_epi64(acc_all, _mm256_add_epi64(word, product));
+	}
+
+	_mm256_storeu_si256((__m256i *)acc, acc_all);
+}
+
+static bc_hash_accumulate select_accumulate(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return accumulate_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		return accumulate_sse2;
+	}
+	return accumulate_scalar;
+}
+
+static bc_hash_accumulate find_accumulate(int impl)
+{
+	__builtin_cpu_init();
+	switch (impl) {
+	case BC_HASH_IMPL_SCALAR:
+		return accumulate_scalar;
+	case BC_HASH_IMPL_SSE2:
+		return __builtin_cpu_supports("sse2") ? accumulate_sse2 : NULL;
+	case BC_HASH_IMPL_AVX2:
+		return __builtin_cpu_supports("avx2") ? accumulate_avx2 : NULL;
+	default:
+		return NULL;
+	}
+}
+#else
+static bc_hash_accumulate select_accumulate(void)
+{
+	return accumulate_scalar;
+}
+
+static bc_hash_accumulate find_accumulate(int impl)
+{
+	return impl == BC_HASH_IMPL_SCALAR ? accumulate_scalar : NULL;
+}
+#endif
+
+static _Atomic(bc_hash_accumulate) g_accumulate;
+
+static inline bc_hash_accumulate get_accumulate(void)
+{
+	bc_hash_accumulate accumulate =
+		atomic_load_explicit(&g_accumulate, memory_order_relaxed);
+	if (!accumulate) {
+		accumulate = select_accumulate();
+		atomic_store_explicit(&g_accumulate, accumulate, memory_order_relaxed);
+	}
+	return accumulate;
+}
+
+static inline uint64_t
+hash_stripes(uint64_t hash, const unsigned char *src, size_t count)
+{
+	uint64_t acc[BC_HASH_LANES];
+	get_accumulate()(acc, src, count);
+	for (size_t i = 0; i < BC_HASH_LANES; i++) {
+		hash = merge_word(hash, acc[i]);
+	}
+	return hash;
+}
+
+uint64_t hash_bytes(const void *src, size_t len)
+{
+	const unsigned char *at = src;
+	uint64_t hash = len * BC_HASH_PRIME_1;
+
+	if (len >= BC_HASH_STRIPE) {
+		size_t count = len / BC_HASH_STRIPE;
+		hash = hash_stripes(hash, at, count);
+		at += count * BC_HASH_STRIPE;
+		len -= count * BC_HASH_STRIPE;
+	}
+
+	while (len >= sizeof(uint64_t)) {
+		hash = merge_word(hash, read_word(at));
+		at += sizeof(uint64_t);
+		len -= sizeof(uint64_t);
+	}
+
+	if (len) {
+		uint64_t tail = 0;
+		memcpy(&tail, at, len);
+		hash = merge_word(hash, tail);
+	}
+	return mix_word(hash);
+}
+
+/* Forces one stripe kernel, false if this CPU or build does not have it */
+bool hash_set_impl(int impl)
+{
+	bc_hash_accumulate accumulate = find_accumulate(impl);
+	if (!accumulate) {
+		return false;
+	}
+	atomic_store_explicit(&g_accumulate, accumulate, memory_order_relaxed);
+	return true;
+}
@@ -1,17 +1,45 @@
 #include "error.h"
+#include "hash.h"
 #include "imm_str.h"
+#include "lock.h"
 #include "rc.h"
 
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+/* Configuration Knobs */
+
+#ifndef BC_IMM_STR_INTERN_SHARD_BITS
+#	define BC_IMM_STR_INTERN_SHARD_BITS 6
+#endif
+
+#ifndef BC_IMM_STR_INTERN_INIT_CAP
+#	define BC_IMM_STR_INTERN_INIT_CAP 64
+#endif
+
+#ifndef BC_IMM_STR_INTERN_MAX
+#	define BC_IMM_STR_INTERN_MAX (1 << 20)
+#endif
+
 typedef struct bc_imm_str {
 	size_t len;
+	atomic_uint_least64_t hash;
 	char data[];
 } bc_imm_str;
 
+static_assert(
+	offsetof(bc_imm_str, hash) == sizeof(size_t) &&
+		sizeof(atomic_uint_least64_t) == sizeof(uint64_t) &&
+		offsetof(bc_imm_str, data) == sizeof(size_t) + sizeof(uint64_t),
+	"BC_IMM_STR_STATIC does not match bc_imm_str");
+
 size_t imm_str_len(const bc_imm_str *str)
 {
 	return str->len;
@@ -22,6 +50,32 @@ const char *imm_str_read(const bc_imm_str *str)
 	return str->data;
 }
 
+char *imm_str_write(bc_imm_str *str)
+{
+	return str->data;
+}
+
+uint64_t imm_str_hash(const bc_imm_str *str)
+{
+	bc_imm_str *mut_str = (bc_imm_str *)str;
+	uint64_t hash = atomic_load_explicit(&mut_str->hash, memory_order_relaxed);
+	if (!hash) {
+		hash = hash_bytes(str->data, str->len);
+		atomic_store_explicit(&mut_str->hash, hash, memory_order_relaxed);
+	}
+	return hash;
+}
+
+bool imm_str_equal(const bc_imm_str *a, const bc_imm_str *b)
+{
+	if (a == b) {
+		return true;
+	} else if (a->len != b->len || imm_str_hash(a) != imm_str_hash(b)) {
+		return false;
+	}
+	return !memcmp(a->data, b->data, a->len);
+}
+
 static inline size_t get_tagged_size(size_t len)
 {
 	static const size_t header_size = offsetof(bc_imm_str, data);
@@ -49,10 +103,41 @@ static inline bc_imm_str *alloc_str(size_t len)
 	}
 
 	str->len = len;
+	atomic_init(&str->hash, 0);
+
+	return str;
+}
+
+bc_imm_str *imm_str_alloc(size_t len)
+{
+	bc_imm_str *str = alloc_str(len);
+	if (!str) {
+		return NULL;
+	}
 
+	str->data[len] = 0;
 	return str;
 }
 
+bc_imm_str *imm_str_resize(const bc_imm_str *str, size_t len)
+{
+	size_t total = get_tagged_size(len);
+	if (!total) {
+		rc_unref(str);
+		return NULL;
+	}
+
+	bc_imm_str *dest = rc_resize(str, total);
+	if (!dest) {
+		return NULL;
+	}
+
+	dest->len = len;
+	atomic_store_explicit(&dest->hash, 0, memory_order_relaxed);
+	dest->data[len] = 0;
+	return dest;
+}
+
 const bc_imm_str *imm_str_create(const char *src)
 {
 	return imm_str_create_n(src, strlen(src));
@@ -88,20 +173,172 @@ const bc_imm_str *imm_str_from_file(FILE *f, size_t len)
 	return str;
 }
 
+const bc_imm_str *imm_str_map(int fd, size_t len)
+{
+	bc_imm_str *str =
+		rc_alloc_mapped(offsetof(bc_imm_str, data), fd, len, NULL);
+	if (!str) {
+		return NULL;
+	}
+
+	str->len = len;
+	atomic_init(&str->hash, 0);
+
+	return str;
+}
+
+/* Interning */
+
+typedef struct bc_intern_slot {
+	uint64_t hash;
+	const bc_imm_str *str;
+} bc_intern_slot;
+
+typedef struct bc_intern_shard {
+	alignas(64) bc_lock lock;
+	size_t len;
+	size_t cap;
+	bc_intern_slot *slots;
+} bc_intern_shard;
+
+enum {
+	BC_IMM_STR_INTERN_SHARDS = 1 << BC_IMM_STR_INTERN_SHARD_BITS,
+	BC_IMM_STR_INTERN_SHARD_MAX =
+		(BC_IMM_STR_INTERN_MAX + BC_IMM_STR_INTERN_SHARDS - 1) /
+		BC_IMM_STR_INTERN_SHARDS,
+};
+
+static bc_intern_shard g_intern_shards[BC_IMM_STR_INTERN_SHARDS] = {
+	[0 ... BC_IMM_STR_INTERN_SHARDS - 1] = {.lock = BC_LOCK_INIT},
+};
+
+static inline bool is_str_match(
+	const bc_intern_slot *slot, uint64_t hash, const char *src, size_t len)
+{
+	return slot->hash == hash && slot->str->len == len &&
+		   !memcmp(slot->str->data, src, len);
+}
+
+static inline bc_intern_slot *
+find_slot(const bc_intern_shard *shard, uint64_t hash, const char *src,
+		  size_t len)
+{
+	size_t mask = shard->cap - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		bc_intern_slot *slot = &shard->slots[i];
+		if (!slot->str || is_str_match(slot, hash, src, len)) {
+			return slot;
+		}
+	}
+}
+
+static inline bool grow_shard(bc_intern_shard *shard)
+{
+	size_t cap = shard->cap ? shard->cap * 2 : BC_IMM_STR_INTERN_INIT_CAP;
+	bc_intern_slot *slots = calloc(cap, sizeof(*slots));
+	if (!slots) {
+		error_alloc(cap * sizeof(*slots));
+		return false;
+	}
+
+	bc_intern_slot *prev_slots = shard->slots;
+	size_t prev_cap = shard->cap;
+	shard->slots = slots;
+	shard->cap = cap;
+	for (size_t i = 0; i < prev_cap; i++) {
+		const bc_intern_slot *slot = &prev_slots[i];
+		if (!slot->str) {
+			continue;
+		}
+
+		size_t j = slot->hash & (cap - 1);
+		while (slots[j].str) {
+			j = (j + 1) & (cap - 1);
+		}
+		slots[j] = *slot;
+	}
+
+	free(prev_slots);
+	return true;
+}
+
+static inline const bc_imm_str *
+insert_str(bc_intern_shard *shard, uint64_t hash, const char *src, size_t len)
+{
+	if ((shard->len + 1) * 4 > shard->cap * 3 && !grow_shard(shard)) {
+		return NULL;
+	}
+
+	bc_imm_str *str = alloc_str(len);
+	if (!str) {
+		return NULL;
+	}
+
+	memcpy(str->data, src, len);
+	str->data[len] = 0;
+	atomic_init(&str->hash, hash);
+	str = (bc_imm_str *)rc_immortalize(str);
+
+	bc_intern_slot *slot = find_slot(shard, hash, src, len);
+	slot->hash = hash;
+	slot->str = str;
+	shard->len++;
+	return str;
+}
+
+const bc_imm_str *imm_str_intern(const char *src)
+{
+	return imm_str_intern_n(src, strlen(src));
+}
+
+const bc_imm_str *imm_str_intern_n(const char *src, size_t len)
+{
+	uint64_t hash = hash_bytes(src, len);
+	bc_intern_shard *shard =
+		&g_intern_shards[hash >> (64 - BC_IMM_STR_INTERN_SHARD_BITS)];
+
+	lock_acquire(&shard->lock);
+	const bc_imm_str *str = NULL;
+	if (shard->cap) {
+		str = find_slot(shard, hash, src, len)->str;
+	}
+
+	/* A full shard hands out ordinary copies, which the caller releases */
+	bool is_full = shard->len >= BC_IMM_STR_INTERN_SHARD_MAX;
+	if (!str && !is_full) {
+		str = insert_str(shard, hash, src, len);
+	}
+	lock_release(&shard->lock);
+
+	if (!str && is_full) {
+		str = imm_str_create_n(src, len);
+	}
+	return str;
+}
+
 /* Slice Methods */
 
 void imm_str_slice_init(
 	bc_imm_str_slice *slice, const bc_imm_str *str, const char *at, size_t len)
 {
-	slice->str = str;
-	slice->at = at;
-	slice->len = len;
+	if (len > BC_IMM_STR_SLICE_SMALL_MAX) {
+		slice->str = str;
+		slice->at = at;
+		slice->len = len;
+		return;
+	}
+
+	if (len) {
+		memcpy(slice->small, at, len);
+	}
+	slice->len = len | BC_IMM_STR_SLICE_SMALL;
+	rc_unref(str);
 }
 
 void imm_str_slice_reinit(
 	bc_imm_str_slice *slice, const bc_imm_str *str, const char *at, size_t len)
 {
-	rc_unref(slice->str);
+	rc_unref(imm_str_slice_str(slice));
 	imm_str_slice_init(slice, str, at, len);
 }
 
@@ -0,0 +1 @@
+#include "loc/loc.0.0.h"
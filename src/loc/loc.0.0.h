@@ -0,0 +1,173 @@
+#include "error.h"
+#include "imm_str.h"
+#include "loc.h"
+#include "lock.h"
+#include "rc.h"
+#include "src_file.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_LOC_INIT_CAP
+#	define BC_LOC_INIT_CAP 64
+#endif
+
+typedef struct bc_loc_entry {
+	bc_loc base;
+	const bc_src_file *file;
+} bc_loc_entry;
+
+/* Entries are append-only. Growing copies them into a larger table and
+ * keeps the old one alive, so readers search without taking the lock. */
+typedef struct bc_loc_table {
+	struct bc_loc_table *prev;
+	size_t cap;
+	bc_loc_entry entries[];
+} bc_loc_table;
+
+static bc_lock g_loc_lock = BC_LOCK_INIT;
+static bc_loc g_loc_next = BC_LOC_NONE + 1;
+static _Atomic(bc_loc_table *) g_loc_table;
+static atomic_size_t g_loc_len;
+
+static inline bc_loc_table *grow_table(bc_loc_table *table, size_t len)
+{
+	size_t cap = table ? table->cap * 2 : BC_LOC_INIT_CAP;
+	size_t total = sizeof(*table) + cap * sizeof(*table->entries);
+	bc_loc_table *grown = malloc(total);
+	if (!grown) {
+		error_alloc(total);
+		return NULL;
+	}
+
+	grown->prev = table;
+	grown->cap = cap;
+	if (len) {
+		memcpy(grown->entries, table->entries, len * sizeof(*table->entries));
+	}
+	atomic_store_explicit(&g_loc_table, grown, memory_order_release);
+	return grown;
+}
+
+static inline bool push_entry(bc_loc base, const bc_src_file *file)
+{
+	bc_loc_table *table =
+		atomic_load_explicit(&g_loc_table, memory_order_relaxed);
+	size_t len = atomic_load_explicit(&g_loc_len, memory_order_relaxed);
+	if ((!table || len == table->cap) && !(table = grow_table(table, len))) {
+		return false;
+	}
+
+	table->entries[len] = (bc_loc_entry){base, rc_ref(file)};
+	atomic_store_explicit(&g_loc_len, len + 1, memory_order_release);
+	return true;
+}
+
+static inline bc_loc register_file(const bc_src_file *file)
+{
+	size_t span = imm_str_len(src_file_text(file)) + 1;
+
+	lock_acquire(&g_loc_lock);
+	bc_loc base = src_file_loc_base(file);
+	if (base) {
+		lock_release(&g_loc_lock);
+		return base;
+	} else if (span > UINT32_MAX - g_loc_next) {
+		lock_release(&g_loc_lock);
+		error_msg(
+			BC_ERROR_ABORT,
+			"Source location space exhausted by file '%s' (%zu bytes)",
+			imm_str_read(src_file_path(file)), span - 1);
+		return BC_LOC_NONE;
+	} else if (!push_entry(g_loc_next, file)) {
+		lock_release(&g_loc_lock);
+		return BC_LOC_NONE;
+	}
+
+	base = g_loc_next;
+	g_loc_next += (bc_loc)span;
+	src_file_set_loc_base(file, base);
+	lock_release(&g_loc_lock);
+	return base;
+}
+
+bc_loc loc_encode(const bc_src_file *file, const char *at)
+{
+	const bc_imm_str *text = src_file_text(file);
+	uintptr_t offset = (uintptr_t)at - (uintptr_t)imm_str_read(text);
+	if (offset > imm_str_len(text)) {
+		return BC_LOC_NONE;
+	}
+
+	bc_loc base = src_file_loc_base(file);
+	if (!base) {
+		base = register_file(file);
+		if (!base) {
+			return BC_LOC_NONE;
+		}
+	}
+	return base + (bc_loc)offset;
+}
+
+static inline bool find_entry(bc_loc_entry *dest, bc_loc loc)
+{
+	/* The table is published before the length that covers it */
+	size_t len = atomic_load_explicit(&g_loc_len, memory_order_acquire);
+	if (loc == BC_LOC_NONE || !len) {
+		return false;
+	}
+
+	const bc_loc_table *table =
+		atomic_load_explicit(&g_loc_table, memory_order_acquire);
+	size_t low = 0;
+	size_t high = len;
+	while (high - low > 1) {
+		size_t mid = low + (high - low) / 2;
+		if (table->entries[mid].base <= loc) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+
+	const bc_loc_entry *entry = &table->entries[low];
+	if (loc < entry->base ||
+		loc - entry->base > imm_str_len(src_file_text(entry->file))) {
+		return false;
+	}
+	*dest = *entry;
+	return true;
+}
+
+static inline const char *get_entry_at(const bc_loc_entry *entry, bc_loc loc)
+{
+	return imm_str_read(src_file_text(entry->file)) + (loc - entry->base);
+}
+
+const bc_src_file *loc_file(bc_loc loc)
+{
+	bc_loc_entry entry;
+	return find_entry(&entry, loc) ? entry.file : NULL;
+}
+
+const char *loc_at(bc_loc loc)
+{
+	bc_loc_entry entry;
+	return find_entry(&entry, loc) ? get_entry_at(&entry, loc) : NULL;
+}
+
+bool loc_get_pos(size_t *line_dest, size_t *col_dest, bc_loc loc)
+{
+	bc_loc_entry entry;
+	if (!find_entry(&entry, loc)) {
+		return false;
+	}
+	return src_file_get_pos(
+		line_dest, col_dest, entry.file, get_entry_at(&entry, loc));
+}
@@ -1,24 +1,936 @@
 #include "error.h"
+#include "lock.h"
 #include "rc.h"
 
+#include <assert.h>
+#include <errno.h>
+#include <stdalign.h>
 #include <stdatomic.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <threads.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_RC_SLAB_MAX
+#	define BC_RC_SLAB_MAX 512
+#endif
+
+#ifndef BC_RC_SLAB_SIZE
+#	define BC_RC_SLAB_SIZE 65536
+#endif
+
+#ifndef BC_RC_MAGAZINE_SIZE
+#	define BC_RC_MAGAZINE_SIZE 64
+#endif
+
+#ifndef BC_RC_REGION_CHUNK
+#	define BC_RC_REGION_CHUNK 65536
+#endif
+
+#ifndef BC_RC_OWNER_CHUNK
+#	define BC_RC_OWNER_CHUNK 1024
+#endif
+
+#ifndef BC_RC_QUEUE_INIT_CAP
+#	define BC_RC_QUEUE_INIT_CAP 16
+#endif
+
+#ifndef BC_RC_TYPE_MAX
+#	define BC_RC_TYPE_MAX 256
+#endif
+
+/* Constants */
+
+#define BC_RC_CLASS_ALIGN alignof(max_align_t)
+#define BC_RC_CLASS_COUNT (BC_RC_SLAB_MAX / BC_RC_CLASS_ALIGN)
+#define BC_RC_CLASS_LARGE UINT8_MAX
+
+#define BC_RC_OWNER_MAX (BC_RC_OWNER_CHUNK * BC_RC_OWNER_CHUNK)
+#define BC_RC_OWNER_NONE UINT32_MAX
+
+#define BC_RC_TYPE_NONE UINT16_MAX
+
+/* Compact slab tags keep their unused tail length above the flags */
+#define BC_RC_SLACK_SHIFT 4
+
+static_assert(BC_RC_CLASS_COUNT < BC_RC_CLASS_LARGE, "Too many size classes");
+static_assert(BC_RC_TYPE_MAX <= BC_RC_TYPE_NONE, "Too many rc types");
+static_assert(
+	BC_RC_CLASS_ALIGN <= 1 << (8 - BC_RC_SLACK_SHIFT),
+	"Size class slack does not fit in the tag flags");
+
+enum {
+	BC_RC_FLAG_REGION = 1 << 0,
+	BC_RC_FLAG_IMMORTAL = 1 << 1,
+	BC_RC_FLAG_MAPPED = 1 << 2,
+	BC_RC_FLAG_MASK = (1 << BC_RC_SLACK_SHIFT) - 1,
+};
+
+enum {
+	BC_RC_SHARED_MERGED = 1 << 0,
+	BC_RC_SHARED_QUEUED = 1 << 1,
+	BC_RC_SHARED_ONE = 1 << 2,
+};
+
+typedef void (*bc_rc_visit)(const void *, void (*)(const void *));
 
 typedef struct bc_rc_tag {
-	atomic_size_t ref;
+	union {
+		struct {
+			uint32_t ref;
+			atomic_uint_least32_t shared;
+		};
+		struct bc_rc_tag *next;
+	};
+	atomic_uint_least32_t owner;
+	uint16_t type;
+	uint8_t cls;
+	uint8_t flags;
+#if !BC_RC_COMPACT_HEADER
 	size_t size;
-	void (*visit)(const void *, void (*)(const void *));
+#endif
 	char alignas(max_align_t) data[];
 } bc_rc_tag;
 
+typedef struct bc_rc_large {
+	size_t size;
+	char alignas(max_align_t) tag[];
+} bc_rc_large;
+
 static const size_t BC_RC_TAG_SIZE = offsetof(bc_rc_tag, data);
+#if BC_RC_COMPACT_HEADER
+static const size_t BC_RC_LARGE_SIZE = offsetof(bc_rc_large, tag);
+#else
+static const size_t BC_RC_LARGE_SIZE = 0;
+#endif
+
+#if BC_RC_COMPACT_HEADER
+static_assert(
+	sizeof(bc_rc_static) == offsetof(bc_rc_large, tag) + sizeof(bc_rc_tag),
+	"bc_rc_static does not match bc_rc_tag");
+static_assert(
+	offsetof(bc_rc_static, ref) == offsetof(bc_rc_large, tag),
+	"bc_rc_static does not match bc_rc_tag");
+#else
+static_assert(
+	sizeof(bc_rc_static) == sizeof(bc_rc_tag),
+	"bc_rc_static does not match bc_rc_tag");
+static_assert(
+	offsetof(bc_rc_static, size) == offsetof(bc_rc_tag, size),
+	"bc_rc_static does not match bc_rc_tag");
+#endif
+static_assert(
+	offsetof(bc_rc_static, flags) - offsetof(bc_rc_static, ref) ==
+		offsetof(bc_rc_tag, flags),
+	"bc_rc_static does not match bc_rc_tag");
+static_assert(
+	BC_RC_STATIC_SHARED == (BC_RC_SHARED_ONE | BC_RC_SHARED_MERGED) &&
+		BC_RC_STATIC_OWNER == BC_RC_OWNER_NONE &&
+		BC_RC_STATIC_CLASS == BC_RC_CLASS_LARGE &&
+		BC_RC_STATIC_FLAGS == BC_RC_FLAG_IMMORTAL,
+	"bc_rc_static does not match bc_rc_tag");
+
+/* Slab Allocator */
+
+typedef struct bc_rc_block {
+	struct bc_rc_block *next;
+	struct bc_rc_block *next_magazine;
+} bc_rc_block;
+
+typedef struct bc_rc_magazine {
+	bc_rc_block *head;
+	size_t count;
+} bc_rc_magazine;
+
+typedef struct bc_rc_cache {
+	bc_rc_magazine loaded[BC_RC_CLASS_COUNT];
+	char *slab_at[BC_RC_CLASS_COUNT];
+	char *slab_end[BC_RC_CLASS_COUNT];
+	bool registered;
+} bc_rc_cache;
+
+static thread_local bc_rc_cache g_cache;
+
+static bc_lock g_depot_lock = BC_LOCK_INIT;
+static bc_rc_block *g_depot[BC_RC_CLASS_COUNT];
+
+static once_flag g_cache_once = ONCE_FLAG_INIT;
+static tss_t g_cache_key;
+
+static inline size_t get_class(size_t total)
+{
+	return (total - 1) / BC_RC_CLASS_ALIGN;
+}
+
+static inline size_t get_class_size(size_t cls)
+{
+	return (cls + 1) * BC_RC_CLASS_ALIGN;
+}
+
+static inline void push_magazine(size_t cls, bc_rc_block *head)
+{
+	lock_acquire(&g_depot_lock);
+	head->next_magazine = g_depot[cls];
+	g_depot[cls] = head;
+	lock_release(&g_depot_lock);
+}
+
+static inline bc_rc_block *pop_magazine(size_t cls)
+{
+	lock_acquire(&g_depot_lock);
+	bc_rc_block *head = g_depot[cls];
+	if (head) {
+		g_depot[cls] = head->next_magazine;
+	}
+	lock_release(&g_depot_lock);
+	return head;
+}
+
+static inline size_t count_magazine(const bc_rc_block *head)
+{
+	size_t count = 0;
+	for (; head; head = head->next) {
+		count++;
+	}
+	return count;
+}
+
+static void flush_cache(void *cache_ptr)
+{
+	bc_rc_cache *cache = cache_ptr;
+	for (size_t cls = 0; cls < BC_RC_CLASS_COUNT; cls++) {
+		size_t size = get_class_size(cls);
+		while (cache->slab_end[cls] - cache->slab_at[cls] >= (ptrdiff_t)size) {
+			bc_rc_block *block = (bc_rc_block *)cache->slab_at[cls];
+			block->next = cache->loaded[cls].head;
+			cache->loaded[cls].head = block;
+			cache->slab_at[cls] += size;
+		}
+
+		if (cache->loaded[cls].head) {
+			push_magazine(cls, cache->loaded[cls].head);
+		}
+		cache->loaded[cls].head = NULL;
+		cache->loaded[cls].count = 0;
+	}
+}
+
+static void create_cache_key(void)
+{
+	tss_create(&g_cache_key, flush_cache);
+}
+
+static inline void register_cache(bc_rc_cache *cache)
+{
+	call_once(&g_cache_once, create_cache_key);
+	tss_set(g_cache_key, cache);
+	cache->registered = true;
+}
+
+static inline bool refill_slab(bc_rc_cache *cache, size_t cls)
+{
+	char *slab = malloc(BC_RC_SLAB_SIZE);
+	if (!slab) {
+		error_alloc(BC_RC_SLAB_SIZE);
+		return false;
+	}
+	cache->slab_at[cls] = slab;
+	cache->slab_end[cls] = slab + BC_RC_SLAB_SIZE;
+	return true;
+}
+
+static inline void *alloc_small(size_t cls)
+{
+	bc_rc_cache *cache = &g_cache;
+	bc_rc_magazine *mag = &cache->loaded[cls];
+	if (!mag->head) {
+		if (!cache->registered) {
+			register_cache(cache);
+		}
+
+		mag->head = pop_magazine(cls);
+		mag->count = count_magazine(mag->head);
+	}
+
+	bc_rc_block *block = mag->head;
+	if (block) {
+		mag->head = block->next;
+		mag->count--;
+		return block;
+	}
+
+	size_t size = get_class_size(cls);
+	if (cache->slab_end[cls] - cache->slab_at[cls] < (ptrdiff_t)size &&
+		!refill_slab(cache, cls)) {
+		return NULL;
+	}
+
+	block = (bc_rc_block *)cache->slab_at[cls];
+	cache->slab_at[cls] += size;
+	return block;
+}
+
+static inline void free_small(void *ptr, size_t cls)
+{
+	bc_rc_cache *cache = &g_cache;
+	if (!cache->registered) {
+		register_cache(cache);
+	}
+
+	bc_rc_magazine *mag = &cache->loaded[cls];
+	bc_rc_block *block = ptr;
+	block->next = mag->head;
+	mag->head = block;
+	mag->count++;
+	if (mag->count < 2 * BC_RC_MAGAZINE_SIZE) {
+		return;
+	}
+
+	bc_rc_block *last = mag->head;
+	for (size_t i = 1; i < BC_RC_MAGAZINE_SIZE; i++) {
+		last = last->next;
+	}
+	push_magazine(cls, mag->head);
+	mag->head = last->next;
+	last->next = NULL;
+	mag->count -= BC_RC_MAGAZINE_SIZE;
+}
+
+static inline void *alloc_block(size_t total)
+{
+	void *ptr;
+	if (total > BC_RC_SLAB_MAX) {
+		ptr = malloc(total);
+	} else {
+		ptr = alloc_small(get_class(total));
+	}
+
+	if (!ptr) {
+		error_alloc(total);
+	}
+	return ptr;
+}
+
+/* Tags */
+
+static inline uint8_t get_tag_class(size_t total)
+{
+	if (total > BC_RC_SLAB_MAX) {
+		return BC_RC_CLASS_LARGE;
+	}
+	return (uint8_t)get_class(total);
+}
+
+static inline size_t get_block_size(size_t total, uint8_t cls)
+{
+	if (cls == BC_RC_CLASS_LARGE) {
+		return BC_RC_LARGE_SIZE + total;
+	}
+	return get_class_size(cls);
+}
+
+static inline bc_rc_tag *get_block_tag(void *block, uint8_t cls)
+{
+	if (cls == BC_RC_CLASS_LARGE) {
+		block = (char *)block + BC_RC_LARGE_SIZE;
+	}
+	return block;
+}
+
+static inline bc_rc_large *get_tag_large(const bc_rc_tag *tag)
+{
+	return (bc_rc_large *)((char *)tag - BC_RC_LARGE_SIZE);
+}
+
+static inline size_t get_tag_size(const bc_rc_tag *tag)
+{
+#if BC_RC_COMPACT_HEADER
+	if (tag->cls != BC_RC_CLASS_LARGE) {
+		size_t slack = tag->flags >> BC_RC_SLACK_SHIFT;
+		return get_class_size(tag->cls) - BC_RC_TAG_SIZE - slack;
+	}
+	return get_tag_large(tag)->size;
+#else
+	return tag->size;
+#endif
+}
+
+static inline void set_tag_size(bc_rc_tag *tag, size_t size)
+{
+#if BC_RC_COMPACT_HEADER
+	if (tag->cls == BC_RC_CLASS_LARGE) {
+		get_tag_large(tag)->size = size;
+		return;
+	}
+
+	size_t slack = get_class_size(tag->cls) - BC_RC_TAG_SIZE - size;
+	tag->flags = (uint8_t)((tag->flags & BC_RC_FLAG_MASK) |
+						   slack << BC_RC_SLACK_SHIFT);
+#else
+	tag->size = size;
+#endif
+}
+
+static inline size_t get_page_size(void)
+{
+	static atomic_size_t page_size;
+	size_t size = atomic_load_explicit(&page_size, memory_order_relaxed);
+	if (!size) {
+		size = (size_t)sysconf(_SC_PAGESIZE);
+		atomic_store_explicit(&page_size, size, memory_order_relaxed);
+	}
+	return size;
+}
+
+static inline void unmap_tag(bc_rc_tag *tag)
+{
+	size_t page_size = get_page_size();
+	uintptr_t start = (uintptr_t)get_tag_large(tag) & ~(page_size - 1);
+	uintptr_t end = (uintptr_t)(tag->data + get_tag_size(tag));
+	end = (end + page_size - 1) & ~(page_size - 1);
+	munmap((void *)start, end - start);
+}
+
+static inline void free_tag(bc_rc_tag *tag)
+{
+	if (tag->flags & BC_RC_FLAG_MAPPED) {
+		unmap_tag(tag);
+	} else if (tag->cls == BC_RC_CLASS_LARGE) {
+		free(get_tag_large(tag));
+	} else {
+		free_small(tag, tag->cls);
+	}
+}
+
+/* Regions */
+
+typedef struct bc_rc_chunk {
+	struct bc_rc_chunk *next;
+	char *end;
+	bool large;
+	char alignas(max_align_t) data[];
+} bc_rc_chunk;
+
+typedef struct bc_rc_region {
+	struct bc_rc_region *prev;
+	bc_rc_chunk *chunks;
+	bc_rc_chunk *current;
+	char *at;
+	char *end;
+	size_t visit_count;
+} bc_rc_region;
+
+static thread_local bc_rc_region *g_region;
+
+static inline bc_rc_chunk *
+create_chunk(bc_rc_region *region, size_t size, bool large)
+{
+	size_t total = offsetof(bc_rc_chunk, data) + size;
+	bc_rc_chunk *chunk = malloc(total);
+	if (!chunk) {
+		error_alloc(total);
+		return NULL;
+	}
+
+	chunk->next = region->chunks;
+	chunk->end = chunk->data + size;
+	chunk->large = large;
+	region->chunks = chunk;
+	return chunk;
+}
+
+static inline void *
+alloc_region(bc_rc_region *region, size_t stride, uint8_t cls)
+{
+	if (cls == BC_RC_CLASS_LARGE) {
+		bc_rc_chunk *chunk = create_chunk(region, stride, true);
+		return chunk ? chunk->data : NULL;
+	}
+
+	if ((size_t)(region->end - region->at) < stride) {
+		bc_rc_chunk *chunk = create_chunk(region, BC_RC_REGION_CHUNK, false);
+		if (!chunk) {
+			return NULL;
+		} else if (region->current) {
+			region->current->end = region->at;
+		}
+		region->current = chunk;
+		region->at = chunk->data;
+		region->end = chunk->end;
+	}
+
+	void *ptr = region->at;
+	region->at += stride;
+	return ptr;
+}
+
+bool rc_region_push(void)
+{
+	bc_rc_region *region = malloc(sizeof(*region));
+	if (!region) {
+		error_alloc(sizeof(*region));
+		return false;
+	}
+
+	memset(region, 0, sizeof(*region));
+	region->prev = g_region;
+	g_region = region;
+	return true;
+}
+
+static inline bc_rc_visit get_tag_visit(const bc_rc_tag *tag);
+
+static inline void release_chunk_refs(bc_rc_chunk *chunk)
+{
+	if (chunk->large) {
+		bc_rc_tag *tag = get_block_tag(chunk->data, BC_RC_CLASS_LARGE);
+		bc_rc_visit visit = get_tag_visit(tag);
+		if (visit) {
+			visit(tag->data, rc_unref);
+		}
+		return;
+	}
+
+	char *at = chunk->data;
+	while (at < chunk->end) {
+		bc_rc_tag *tag = (bc_rc_tag *)at;
+		bc_rc_visit visit = get_tag_visit(tag);
+		if (visit) {
+			visit(tag->data, rc_unref);
+		}
+		at += get_class_size(tag->cls);
+	}
+}
+
+void rc_region_pop(void)
+{
+	bc_rc_region *region = g_region;
+	if (!region) {
+		return;
+	}
+	g_region = region->prev;
+
+	if (region->current) {
+		region->current->end = region->at;
+	}
+
+	if (region->visit_count) {
+		for (bc_rc_chunk *chunk = region->chunks; chunk; chunk = chunk->next) {
+			release_chunk_refs(chunk);
+		}
+	}
+
+	bc_rc_chunk *chunk = region->chunks;
+	while (chunk) {
+		bc_rc_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	free(region);
+}
+
+/* Thread Ownership */
+
+typedef struct bc_rc_owner {
+	bc_lock lock;
+	bool closed;
+	atomic_bool pending;
+	bc_rc_tag **queue;
+	size_t len;
+	size_t cap;
+} bc_rc_owner;
+
+static bc_lock g_owner_lock = BC_LOCK_INIT;
+static atomic_uint_least32_t g_owner_count;
+static _Atomic(bc_rc_owner *) *g_owners[BC_RC_OWNER_CHUNK];
+
+static thread_local uint32_t g_owner_id;
+static thread_local bc_rc_owner *g_owner;
+
+static once_flag g_owner_once = ONCE_FLAG_INIT;
+static tss_t g_owner_key;
+
+static void release_tag(bc_rc_tag *tag);
+
+static inline int32_t get_shared_count(uint32_t shared)
+{
+	return (int32_t)shared >> 2;
+}
+
+static inline bc_rc_owner *find_owner(uint32_t id)
+{
+	_Atomic(bc_rc_owner *) *chunk = g_owners[id / BC_RC_OWNER_CHUNK];
+	return atomic_load_explicit(
+		&chunk[id % BC_RC_OWNER_CHUNK], memory_order_acquire);
+}
+
+static inline void merge_tag(bc_rc_tag *tag, uint32_t queued)
+{
+	uint32_t delta = tag->ref << 2;
+	tag->ref = 0;
+	if (atomic_exchange_explicit(
+			&tag->owner, BC_RC_OWNER_NONE, memory_order_acq_rel) !=
+		BC_RC_OWNER_NONE) {
+		delta += BC_RC_SHARED_MERGED;
+	}
+	delta -= queued;
+
+	uint32_t shared = atomic_fetch_add_explicit(
+						  &tag->shared, delta, memory_order_acq_rel) +
+					  delta;
+	if (!(shared & BC_RC_SHARED_QUEUED) && !get_shared_count(shared)) {
+		release_tag(tag);
+	}
+}
+
+static inline void unqueue_tag(bc_rc_tag *tag)
+{
+	uint32_t shared = atomic_fetch_sub_explicit(
+						  &tag->shared, BC_RC_SHARED_QUEUED,
+						  memory_order_acq_rel) -
+					  BC_RC_SHARED_QUEUED;
+	if ((shared & BC_RC_SHARED_MERGED) && !get_shared_count(shared)) {
+		release_tag(tag);
+	}
+}
+
+static inline void drain_owner(bc_rc_owner *owner)
+{
+	while (atomic_load_explicit(&owner->pending, memory_order_acquire)) {
+		lock_acquire(&owner->lock);
+		bc_rc_tag **queue = owner->queue;
+		size_t len = owner->len;
+		owner->queue = NULL;
+		owner->len = 0;
+		owner->cap = 0;
+		atomic_store_explicit(&owner->pending, false, memory_order_relaxed);
+		lock_release(&owner->lock);
+
+		for (size_t i = 0; i < len; i++) {
+			merge_tag(queue[i], BC_RC_SHARED_QUEUED);
+		}
+		free(queue);
+	}
+}
+
+static void close_owner(void *owner_ptr)
+{
+	bc_rc_owner *owner = owner_ptr;
+	lock_acquire(&owner->lock);
+	owner->closed = true;
+	lock_release(&owner->lock);
+	drain_owner(owner);
+}
+
+static inline bool reserve_queue(bc_rc_owner *owner)
+{
+	if (owner->len < owner->cap) {
+		return true;
+	}
+
+	size_t cap = owner->cap ? 2 * owner->cap : BC_RC_QUEUE_INIT_CAP;
+	bc_rc_tag **queue = realloc(owner->queue, cap * sizeof(*queue));
+	if (!queue) {
+		return false;
+	}
+	owner->queue = queue;
+	owner->cap = cap;
+	return true;
+}
+
+static inline void enqueue_tag(bc_rc_tag *tag, uint32_t owner_id)
+{
+	bc_rc_owner *owner = find_owner(owner_id);
+	bool reported = false;
+	while (true) {
+		lock_acquire(&owner->lock);
+		if (owner->closed) {
+			lock_release(&owner->lock);
+			merge_tag(tag, BC_RC_SHARED_QUEUED);
+			return;
+		} else if (reserve_queue(owner)) {
+			break;
+		}
+
+		size_t cap = owner->cap ? 2 * owner->cap : BC_RC_QUEUE_INIT_CAP;
+		lock_release(&owner->lock);
+		if (!reported) {
+			error_alloc(cap * sizeof(*owner->queue));
+			reported = true;
+		}
+		thrd_yield();
+	}
+
+	owner->queue[owner->len++] = tag;
+	atomic_store_explicit(&owner->pending, true, memory_order_release);
+	lock_release(&owner->lock);
+}
+
+static void create_owner_key(void)
+{
+	tss_create(&g_owner_key, close_owner);
+}
+
+static inline bool publish_owner(uint32_t id, bc_rc_owner *owner)
+{
+	size_t index = id / BC_RC_OWNER_CHUNK;
+	lock_acquire(&g_owner_lock);
+	if (!g_owners[index]) {
+		g_owners[index] = calloc(BC_RC_OWNER_CHUNK, sizeof(*g_owners[index]));
+	}
+	lock_release(&g_owner_lock);
+
+	if (!g_owners[index]) {
+		error_alloc(BC_RC_OWNER_CHUNK * sizeof(*g_owners[index]));
+		return false;
+	}
+
+	atomic_store_explicit(
+		&g_owners[index][id % BC_RC_OWNER_CHUNK], owner, memory_order_release);
+	return true;
+}
+
+static uint32_t register_owner(void)
+{
+	uint32_t id =
+		atomic_fetch_add_explicit(&g_owner_count, 1, memory_order_relaxed) +
+		1;
+	if (id >= BC_RC_OWNER_MAX) {
+		error_msg(
+			BC_ERROR_ALLOC_LEVEL,
+			"Number of ref-counting threads exceeds platform maximum %u",
+			BC_RC_OWNER_MAX - 1);
+		return 0;
+	}
+
+	bc_rc_owner *owner = calloc(1, sizeof(*owner));
+	if (!owner) {
+		error_alloc(sizeof(*owner));
+		return 0;
+	} else if (!publish_owner(id, owner)) {
+		free(owner);
+		return 0;
+	}
+
+	call_once(&g_owner_once, create_owner_key);
+	tss_set(g_owner_key, owner);
+	g_owner = owner;
+	g_owner_id = id;
+	return id;
+}
+
+static inline uint32_t get_owner_id(void)
+{
+	uint32_t id = g_owner_id;
+	if (id) {
+		return id;
+	}
+	return register_owner();
+}
+
+/* Deferred Release */
+
+static thread_local bc_rc_tag *g_dead;
+static thread_local bool g_releasing;
+
+static atomic_bool g_deferred;
+static once_flag g_defer_once = ONCE_FLAG_INIT;
+static mtx_t g_defer_mtx;
+static cnd_t g_defer_cnd;
+static bc_rc_tag *g_defer_list;
+static bool g_collector_running;
+static bool g_collector_stop;
+static thrd_t g_collector;
+
+static void init_defer(void)
+{
+	mtx_init(&g_defer_mtx, mtx_plain);
+	cnd_init(&g_defer_cnd);
+}
+
+static inline void defer_tag(bc_rc_tag *tag)
+{
+	mtx_lock(&g_defer_mtx);
+	tag->next = g_defer_list;
+	g_defer_list = tag;
+	if (g_collector_running && !tag->next) {
+		cnd_signal(&g_defer_cnd);
+	}
+	mtx_unlock(&g_defer_mtx);
+}
+
+static inline void release_dead(void)
+{
+	g_releasing = true;
+	bc_rc_tag *tag;
+	while ((tag = g_dead)) {
+		g_dead = tag->next;
+		bc_rc_visit visit = get_tag_visit(tag);
+		if (visit) {
+			visit(tag->data, rc_unref);
+		}
+		free_tag(tag);
+	}
+	g_releasing = false;
+}
+
+static inline void release_list(bc_rc_tag *list)
+{
+	if (!list) {
+		return;
+	}
+
+	bc_rc_tag *last = list;
+	while (last->next) {
+		last = last->next;
+	}
+	last->next = g_dead;
+	g_dead = list;
+	if (!g_releasing) {
+		release_dead();
+	}
+}
+
+void rc_defer(bool deferred)
+{
+	call_once(&g_defer_once, init_defer);
+	atomic_store_explicit(&g_deferred, deferred, memory_order_relaxed);
+}
+
+void rc_collect(void)
+{
+	call_once(&g_defer_once, init_defer);
+
+	mtx_lock(&g_defer_mtx);
+	bc_rc_tag *list = g_defer_list;
+	g_defer_list = NULL;
+	mtx_unlock(&g_defer_mtx);
+
+	release_list(list);
+}
+
+static int run_collector(void *arg)
+{
+	(void)arg;
+	mtx_lock(&g_defer_mtx);
+	while (!g_collector_stop) {
+		bc_rc_tag *list = g_defer_list;
+		if (!list) {
+			cnd_wait(&g_defer_cnd, &g_defer_mtx);
+			continue;
+		}
+
+		g_defer_list = NULL;
+		mtx_unlock(&g_defer_mtx);
+		release_list(list);
+		mtx_lock(&g_defer_mtx);
+	}
+	mtx_unlock(&g_defer_mtx);
+	return 0;
+}
+
+bool rc_collector_start(void)
+{
+	rc_defer(true);
+
+	mtx_lock(&g_defer_mtx);
+	if (g_collector_running) {
+		mtx_unlock(&g_defer_mtx);
+		return true;
+	}
+
+	g_collector_stop = false;
+	g_collector_running =
+		thrd_create(&g_collector, run_collector, NULL) == thrd_success;
+	mtx_unlock(&g_defer_mtx);
+
+	if (!g_collector_running) {
+		error_msg(BC_ERROR_ABORT, "Failed to start rc collector thread");
+	}
+	return g_collector_running;
+}
+
+void rc_collector_stop(void)
+{
+	call_once(&g_defer_once, init_defer);
+
+	mtx_lock(&g_defer_mtx);
+	bool running = g_collector_running;
+	g_collector_stop = true;
+	g_collector_running = false;
+	cnd_signal(&g_defer_cnd);
+	mtx_unlock(&g_defer_mtx);
+
+	if (running) {
+		thrd_join(g_collector, NULL);
+	}
+	rc_collect();
+}
+
+/* Types */
+
+static bc_lock g_type_lock = BC_LOCK_INIT;
+static atomic_uint g_type_count = 1;
+static _Atomic(bc_rc_visit) g_types[BC_RC_TYPE_MAX];
+
+static inline bc_rc_visit get_tag_visit(const bc_rc_tag *tag)
+{
+	return atomic_load_explicit(&g_types[tag->type], memory_order_relaxed);
+}
+
+static uint16_t register_type(bc_rc_visit visit)
+{
+	lock_acquire(&g_type_lock);
+	unsigned count = atomic_load_explicit(&g_type_count, memory_order_relaxed);
+	for (unsigned i = 1; i < count; i++) {
+		if (atomic_load_explicit(&g_types[i], memory_order_relaxed) == visit) {
+			lock_release(&g_type_lock);
+			return (uint16_t)i;
+		}
+	}
+
+	if (count == BC_RC_TYPE_MAX) {
+		lock_release(&g_type_lock);
+		error_msg(
+			BC_ERROR_ALLOC_LEVEL,
+			"Number of ref-counted types exceeds platform maximum %u",
+			BC_RC_TYPE_MAX);
+		return BC_RC_TYPE_NONE;
+	}
+
+	atomic_store_explicit(&g_types[count], visit, memory_order_relaxed);
+	atomic_store_explicit(&g_type_count, count + 1, memory_order_release);
+	lock_release(&g_type_lock);
+	return (uint16_t)count;
+}
+
+static inline uint16_t find_type(bc_rc_visit visit)
+{
+	if (!visit) {
+		return 0;
+	}
+
+	unsigned count = atomic_load_explicit(&g_type_count, memory_order_acquire);
+	for (unsigned i = 1; i < count; i++) {
+		if (atomic_load_explicit(&g_types[i], memory_order_relaxed) == visit) {
+			return (uint16_t)i;
+		}
+	}
+	return register_type(visit);
+}
+
+/* Reference Counting */
 
 static inline size_t get_tagged_size(size_t size)
 {
-	static const size_t max_alloc = SIZE_MAX - BC_RC_TAG_SIZE;
+	static const size_t max_alloc =
+		SIZE_MAX - BC_RC_TAG_SIZE - BC_RC_LARGE_SIZE;
 	if (size > max_alloc) {
 		error_msg(
 			BC_ERROR_ALLOC_LEVEL,
@@ -29,22 +941,119 @@ static inline size_t get_tagged_size(size_t size)
 	return BC_RC_TAG_SIZE + size;
 }
 
-void *rc_alloc(size_t size, void (*visit)(const void *, void (*)(const void *)))
+static inline bc_rc_tag *alloc_tag(bc_rc_region *region, size_t total)
+{
+	uint8_t cls = get_tag_class(total);
+	size_t block_size = get_block_size(total, cls);
+	void *block = region ? alloc_region(region, block_size, cls)
+						 : alloc_block(block_size);
+	if (!block) {
+		return NULL;
+	}
+
+	bc_rc_tag *tag = get_block_tag(block, cls);
+	tag->cls = cls;
+	return tag;
+}
+
+static inline void init_tag(bc_rc_tag *tag, size_t size, uint16_t type)
+{
+	uint32_t owner_id = get_owner_id();
+	if (owner_id) {
+		drain_owner(g_owner);
+		tag->ref = 1;
+		atomic_init(&tag->shared, 0);
+		atomic_init(&tag->owner, owner_id);
+	} else {
+		tag->ref = 0;
+		atomic_init(&tag->shared, BC_RC_SHARED_ONE | BC_RC_SHARED_MERGED);
+		atomic_init(&tag->owner, BC_RC_OWNER_NONE);
+	}
+
+	tag->type = type;
+	tag->flags = 0;
+	set_tag_size(tag, size);
+}
+
+static inline void *alloc_data(size_t size, uint16_t type)
 {
 	size_t total = get_tagged_size(size);
-	bc_rc_tag *tag = malloc(total);
+	if (!total) {
+		return NULL;
+	}
+
+	bc_rc_region *region = g_region;
+	bc_rc_tag *tag = alloc_tag(region, total);
 	if (!tag) {
-		error_alloc(total);
 		return NULL;
 	}
 
-	atomic_init(&tag->ref, 1);
-	tag->size = size;
-	tag->visit = visit;
+	init_tag(tag, size, type);
+	if (region) {
+		tag->flags |= BC_RC_FLAG_REGION;
+		region->visit_count += type != 0;
+	}
 
 	return tag->data;
 }
 
+void *rc_alloc(size_t size, void (*visit)(const void *, void (*)(const void *)))
+{
+	uint16_t type = find_type(visit);
+	if (type == BC_RC_TYPE_NONE) {
+		return NULL;
+	}
+	return alloc_data(size, type);
+}
+
+void *rc_alloc_mapped(
+	size_t header_size, int fd, size_t len,
+	void (*visit)(const void *, void (*)(const void *)))
+{
+	uint16_t type = find_type(visit);
+	if (type == BC_RC_TYPE_NONE) {
+		return NULL;
+	}
+
+	size_t page_size = get_page_size();
+	if (header_size % BC_RC_CLASS_ALIGN ||
+		BC_RC_LARGE_SIZE + BC_RC_TAG_SIZE + header_size > page_size) {
+		error_msg(
+			BC_ERROR_ABORT, "Mapped header size %zu must be aligned to %zu",
+			header_size, (size_t)BC_RC_CLASS_ALIGN);
+		return NULL;
+	} else if (len > SIZE_MAX - 2 * page_size) {
+		error_msg(
+			BC_ERROR_ALLOC_LEVEL,
+			"Requested mapping %zu exceeds platform maximum %zu", len,
+			SIZE_MAX - 2 * page_size);
+		return NULL;
+	}
+
+	size_t body_size = (len + page_size) & ~(page_size - 1);
+	char *base = mmap(
+		NULL, page_size + body_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		error_sys(BC_ERROR_ABORT, errno, "Failed to map %zu bytes", len);
+		return NULL;
+	}
+
+	if (len && mmap(base + page_size, len, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+					fd, 0) == MAP_FAILED) {
+		error_sys(BC_ERROR_ABORT, errno, "Failed to map %zu bytes", len);
+		munmap(base, page_size + body_size);
+		return NULL;
+	}
+
+	bc_rc_tag *tag =
+		(bc_rc_tag *)(base + page_size - header_size - BC_RC_TAG_SIZE);
+	tag->cls = BC_RC_CLASS_LARGE;
+	init_tag(tag, header_size + len + 1, type);
+	tag->flags = BC_RC_FLAG_MAPPED;
+	return tag->data;
+}
+
 static inline bc_rc_tag *get_tag(const void *ptr)
 {
 	return (bc_rc_tag *)((char *)ptr - BC_RC_TAG_SIZE);
@@ -57,30 +1066,105 @@ size_t rc_size(const void *ptr)
 	}
 
 	const bc_rc_tag *tag = get_tag(ptr);
-	return tag->size;
+	return get_tag_size(tag);
+}
+
+static inline bool is_tag_owned(const bc_rc_tag *tag)
+{
+	return atomic_load_explicit(&tag->owner, memory_order_relaxed) ==
+		   g_owner_id;
+}
+
+static void release_tag(bc_rc_tag *tag)
+{
+	if (tag->flags & BC_RC_FLAG_REGION) {
+		return;
+	} else if (
+		!g_releasing &&
+		atomic_load_explicit(&g_deferred, memory_order_relaxed)) {
+		defer_tag(tag);
+		return;
+	}
+
+	tag->next = g_dead;
+	g_dead = tag;
+	if (!g_releasing) {
+		release_dead();
+	}
 }
 
 static inline void inc_tag_ref(bc_rc_tag *tag)
 {
-	atomic_fetch_add_explicit(&tag->ref, 1, memory_order_relaxed);
+	if (tag->flags & BC_RC_FLAG_IMMORTAL) {
+		return;
+	} else if (is_tag_owned(tag)) {
+		tag->ref++;
+		return;
+	}
+	atomic_fetch_add_explicit(
+		&tag->shared, BC_RC_SHARED_ONE, memory_order_relaxed);
+}
+
+static inline void dec_shared_ref(bc_rc_tag *tag)
+{
+	uint32_t shared = atomic_load_explicit(&tag->shared, memory_order_relaxed);
+	uint32_t next;
+	do {
+		next = shared - BC_RC_SHARED_ONE;
+		if (!(next & (BC_RC_SHARED_MERGED | BC_RC_SHARED_QUEUED)) &&
+			get_shared_count(next) < 0) {
+			next |= BC_RC_SHARED_QUEUED;
+		}
+	} while (!atomic_compare_exchange_weak_explicit(
+		&tag->shared, &shared, next, memory_order_release,
+		memory_order_relaxed));
+
+	if ((next ^ shared) & BC_RC_SHARED_QUEUED) {
+		uint32_t owner_id =
+			atomic_load_explicit(&tag->owner, memory_order_acquire);
+		if (owner_id == BC_RC_OWNER_NONE) {
+			unqueue_tag(tag);
+		} else {
+			enqueue_tag(tag, owner_id);
+		}
+	} else if (
+		(next & (BC_RC_SHARED_MERGED | BC_RC_SHARED_QUEUED)) ==
+			BC_RC_SHARED_MERGED &&
+		!get_shared_count(next)) {
+		atomic_thread_fence(memory_order_acquire);
+		release_tag(tag);
+	}
 }
 
-static inline size_t dec_tag_ref(bc_rc_tag *tag)
+static inline void dec_tag_ref(bc_rc_tag *tag)
 {
-	size_t ref = atomic_fetch_sub_explicit(&tag->ref, 1, memory_order_release);
-	if (ref > 1) {
-		return ref - 1;
-	} else if (tag->visit) {
-		tag->visit(tag->data, rc_unref);
+	if (tag->flags & BC_RC_FLAG_IMMORTAL) {
+		return;
+	} else if (!is_tag_owned(tag)) {
+		dec_shared_ref(tag);
+	} else if (!--tag->ref) {
+		merge_tag(tag, 0);
 	}
-	free(tag);
-	return 0;
 }
 
 static inline bool is_tag_unique(const bc_rc_tag *tag)
 {
-	return atomic_load_explicit(&tag->ref, memory_order_relaxed) == 0 &&
-		   atomic_load_explicit(&tag->ref, memory_order_acquire) == 0;
+	if (tag->flags & (BC_RC_FLAG_IMMORTAL | BC_RC_FLAG_MAPPED)) {
+		return false;
+	} else if (is_tag_owned(tag)) {
+		return tag->ref == 1 &&
+			   !atomic_load_explicit(&tag->shared, memory_order_acquire);
+	}
+
+	uint32_t owner_id = atomic_load_explicit(&tag->owner, memory_order_acquire);
+	return owner_id == BC_RC_OWNER_NONE &&
+		   atomic_load_explicit(&tag->shared, memory_order_acquire) ==
+			   (BC_RC_SHARED_ONE | BC_RC_SHARED_MERGED);
+}
+
+bool rc_unique(const void *ptr)
+{
+	return ptr && is_tag_unique(get_tag(ptr));
 }
 
 const void *rc_ref(const void *ptr)
@@ -106,16 +1190,25 @@ static void rc_ref_visit(const void *ptr)
 
 static inline void *clone_data(bc_rc_tag *tag, size_t dest_size)
 {
-	void *dest = rc_alloc(dest_size, tag->visit);
+	void *dest = alloc_data(dest_size, tag->type);
 	if (!dest) {
 		dec_tag_ref(tag);
 		return NULL;
 	}
 
-	memcpy(dest, tag->data, tag->size);
-	if (dec_tag_ref(tag) && tag->visit) {
-		tag->visit(dest, rc_ref_visit);
+	size_t size = get_tag_size(tag);
+	if (dest_size > size) {
+		memcpy(dest, tag->data, size);
+		memset((char *)dest + size, 0, dest_size - size);
+	} else {
+		memcpy(dest, tag->data, dest_size);
+	}
+
+	bc_rc_visit visit = get_tag_visit(tag);
+	if (visit) {
+		visit(dest, rc_ref_visit);
 	}
+	dec_tag_ref(tag);
 	return dest;
 }
 
@@ -129,7 +1222,32 @@ void *rc_edit(const void *src)
 	if (is_tag_unique(tag)) {
 		return (void *)src;
 	}
-	return clone_data(tag, tag->size);
+	return clone_data(tag, get_tag_size(tag));
+}
+
+static inline bc_rc_tag *move_tag(bc_rc_tag *tag, size_t total)
+{
+	uint8_t cls = get_tag_class(total);
+	if (cls == BC_RC_CLASS_LARGE && tag->cls == BC_RC_CLASS_LARGE) {
+		size_t block_size = get_block_size(total, cls);
+		void *block = realloc(get_tag_large(tag), block_size);
+		if (!block) {
+			error_alloc(block_size);
+			return NULL;
+		}
+		return get_block_tag(block, cls);
+	}
+
+	bc_rc_tag *re_tag = alloc_tag(NULL, total);
+	if (!re_tag) {
+		return NULL;
+	}
+
+	size_t prev_total = BC_RC_TAG_SIZE + get_tag_size(tag);
+	memcpy(re_tag, tag, prev_total < total ? prev_total : total);
+	re_tag->cls = cls;
+	free_tag(tag);
+	return re_tag;
 }
 
 static inline bc_rc_tag *realloc_tag(bc_rc_tag *tag, size_t size)
@@ -140,15 +1258,23 @@ static inline bc_rc_tag *realloc_tag(bc_rc_tag *tag, size_t size)
 		return NULL;
 	}
 
-	bc_rc_tag *re_tag = realloc(tag, total);
+	size_t prev_size = get_tag_size(tag);
+	bc_rc_tag *re_tag = tag;
+	if (tag->cls != get_tag_class(total) || tag->cls == BC_RC_CLASS_LARGE) {
+		re_tag = move_tag(tag, total);
+	}
+
 	if (!re_tag) {
-		dec_tag_ref(re_tag);
+		dec_tag_ref(tag);
 		return NULL;
 	}
 	tag = re_tag;
 
-	memset(tag->data + tag->size, 0, size - tag->size);
-	tag->size = size;
+	set_tag_size(tag, size);
+	size = get_tag_size(tag);
+	if (size > prev_size) {
+		memset(tag->data + prev_size, 0, size - prev_size);
+	}
 
 	return tag;
 }
@@ -160,7 +1286,7 @@ void *rc_resize(const void *src, size_t size)
 	}
 
 	bc_rc_tag *tag = get_tag(src);
-	if (is_tag_unique(tag)) {
+	if (!(tag->flags & BC_RC_FLAG_REGION) && is_tag_unique(tag)) {
 		tag = realloc_tag(tag, size);
 		if (!tag) {
 			return NULL;
@@ -169,3 +1295,30 @@ void *rc_resize(const void *src, size_t size)
 	}
 	return clone_data(tag, size);
 }
+
+const void *rc_promote(const void *ptr)
+{
+	if (!ptr) {
+		return NULL;
+	}
+
+	bc_rc_tag *tag = get_tag(ptr);
+	if (!(tag->flags & BC_RC_FLAG_REGION)) {
+		return ptr;
+	}
+
+	bc_rc_region *region = g_region;
+	g_region = NULL;
+	void *dest = clone_data(tag, get_tag_size(tag));
+	g_region = region;
+	return dest;
+}
+
+const void *rc_immortalize(const void *ptr)
+{
+	ptr = rc_promote(ptr);
+	if (ptr) {
+		get_tag(ptr)->flags |= BC_RC_FLAG_IMMORTAL;
+	}
+	return ptr;
+}
@@ -0,0 +1 @@
+#include "rope/rope.0.0.h"
@@ -0,0 +1,404 @@
+#include "error.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "rope.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_ROPE_FLAT_MAX
+#	define BC_ROPE_FLAT_MAX 64
+#endif
+
+#ifndef BC_ROPE_IOV_MAX
+#	define BC_ROPE_IOV_MAX 64
+#endif
+
+/* Constants */
+
+enum {
+	BC_ROPE_HEIGHT_MAX = 96,
+};
+
+/* Nodes */
+
+typedef struct bc_rope {
+	size_t len;
+	unsigned height;
+	union {
+		struct {
+			const bc_imm_str *str;
+			const char *at;
+		};
+		struct {
+			const bc_rope *left;
+			const bc_rope *right;
+		};
+	};
+} bc_rope;
+
+static inline bool is_leaf(const bc_rope *rope)
+{
+	return rope->height == 1;
+}
+
+static void rope_visit(const void *rope_ptr, void (*visitor)(const void *))
+{
+	const bc_rope *rope = rope_ptr;
+	if (is_leaf(rope)) {
+		visitor(rope->str);
+	} else {
+		visitor(rope->left);
+		visitor(rope->right);
+	}
+}
+
+size_t rope_len(const bc_rope *rope)
+{
+	return rope ? rope->len : 0;
+}
+
+/* Out-of-range indexes, including any index into the empty rope, give '\0' */
+char rope_index(const bc_rope *rope, size_t index)
+{
+	if (!rope || index >= rope->len) {
+		return '\0';
+	}
+
+	while (!is_leaf(rope)) {
+		if (index < rope->left->len) {
+			rope = rope->left;
+		} else {
+			index -= rope->left->len;
+			rope = rope->right;
+		}
+	}
+	return rope->at[index];
+}
+
+static inline const bc_rope *
+create_leaf(const bc_imm_str *str, const char *at, size_t len)
+{
+	bc_rope *rope = rc_alloc(sizeof(bc_rope), rope_visit);
+	if (!rope) {
+		rc_unref(str);
+		return NULL;
+	}
+
+	rope->len = len;
+	rope->height = 1;
+	rope->str = str;
+	rope->at = at;
+	return rope;
+}
+
+static inline const bc_rope *
+create_concat(const bc_rope *left, const bc_rope *right)
+{
+	bc_rope *rope = NULL;
+	if (left && right) {
+		rope = rc_alloc(sizeof(bc_rope), rope_visit);
+	}
+	if (!rope) {
+		rc_unref(left);
+		rc_unref(right);
+		return NULL;
+	}
+
+	unsigned height =
+		left->height > right->height ? left->height : right->height;
+	rope->len = left->len + right->len;
+	rope->height = height + 1;
+	rope->left = left;
+	rope->right = right;
+	return rope;
+}
+
+/* Concatenation */
+
+static inline const bc_rope *
+merge_leaves(const bc_rope *left, const bc_rope *right)
+{
+	size_t len = left->len + right->len;
+	bc_imm_str *str = imm_str_alloc(len);
+	if (str) {
+		memcpy(imm_str_write(str), left->at, left->len);
+		memcpy(imm_str_write(str) + left->len, right->at, right->len);
+	}
+
+	rc_unref(left);
+	rc_unref(right);
+	if (!str) {
+		return NULL;
+	}
+	return create_leaf(str, imm_str_read(str), len);
+}
+
+static inline const bc_rope *
+rotate_concat(const bc_rope *left, const bc_rope *right)
+{
+	if (left->height > right->height + 1) {
+		const bc_rope *outer = rc_ref(left->left);
+		const bc_rope *inner = rc_ref(left->right);
+		rc_unref(left);
+		if (outer->height >= inner->height) {
+			return create_concat(outer, create_concat(inner, right));
+		}
+
+		const bc_rope *inner_left = rc_ref(inner->left);
+		const bc_rope *inner_right = rc_ref(inner->right);
+		rc_unref(inner);
+		return create_concat(
+			create_concat(outer, inner_left),
+			create_concat(inner_right, right));
+	} else if (right->height > left->height + 1) {
+		const bc_rope *outer = rc_ref(right->right);
+		const bc_rope *inner = rc_ref(right->left);
+		rc_unref(right);
+		if (outer->height >= inner->height) {
+			return create_concat(create_concat(left, inner), outer);
+		}
+
+		const bc_rope *inner_left = rc_ref(inner->left);
+		const bc_rope *inner_right = rc_ref(inner->right);
+		rc_unref(inner);
+		return create_concat(
+			create_concat(left, inner_left),
+			create_concat(inner_right, outer));
+	}
+	return create_concat(left, right);
+}
+
+static const bc_rope *join_ropes(const bc_rope *left, const bc_rope *right)
+{
+	if (left->height > right->height + 1) {
+		const bc_rope *outer = rc_ref(left->left);
+		const bc_rope *inner = rc_ref(left->right);
+		rc_unref(left);
+
+		inner = join_ropes(inner, right);
+		if (!inner) {
+			rc_unref(outer);
+			return NULL;
+		}
+		return rotate_concat(outer, inner);
+	} else if (right->height > left->height + 1) {
+		const bc_rope *outer = rc_ref(right->right);
+		const bc_rope *inner = rc_ref(right->left);
+		rc_unref(right);
+
+		inner = join_ropes(left, inner);
+		if (!inner) {
+			rc_unref(outer);
+			return NULL;
+		}
+		return rotate_concat(inner, outer);
+	} else if (
+		is_leaf(left) && is_leaf(right) &&
+		left->len + right->len <= BC_ROPE_FLAT_MAX) {
+		return merge_leaves(left, right);
+	}
+	return create_concat(left, right);
+}
+
+const bc_rope *rope_from_str(const bc_imm_str *str)
+{
+	if (!str) {
+		return NULL;
+	}
+	return rope_from_slice(str, imm_str_read(str), imm_str_len(str));
+}
+
+const bc_rope *
+rope_from_slice(const bc_imm_str *str, const char *at, size_t len)
+{
+	if (!len) {
+		rc_unref(str);
+		return NULL;
+	} else if (!str) {
+		/* Leaves always own their bytes, borrowed data is copied */
+		str = imm_str_create_n(at, len);
+		if (!str) {
+			return NULL;
+		}
+		at = imm_str_read(str);
+	}
+	return create_leaf(str, at, len);
+}
+
+const bc_rope *rope_from_str_slice(const bc_imm_str_slice *slice)
+{
+	if (!slice) {
+		return NULL;
+	}
+	return rope_from_slice(
+		rc_ref(imm_str_slice_str(slice)), imm_str_slice_read(slice),
+		imm_str_slice_len(slice));
+}
+
+const bc_rope *rope_concat(const bc_rope *left, const bc_rope *right)
+{
+	if (!left) {
+		return right;
+	} else if (!right) {
+		return left;
+	}
+	return join_ropes(left, right);
+}
+
+/* Substrings */
+
+static const bc_rope *
+slice_rope(const bc_rope *rope, size_t start, size_t len)
+{
+	if (!start && len == rope->len) {
+		return rc_ref(rope);
+	} else if (is_leaf(rope)) {
+		return create_leaf(rc_ref(rope->str), rope->at + start, len);
+	}
+
+	size_t left_len = rope->left->len;
+	if (start + len <= left_len) {
+		return slice_rope(rope->left, start, len);
+	} else if (start >= left_len) {
+		return slice_rope(rope->right, start - left_len, len);
+	}
+
+	const bc_rope *left = slice_rope(rope->left, start, left_len - start);
+	if (!left) {
+		return NULL;
+	}
+
+	const bc_rope *right =
+		slice_rope(rope->right, 0, len - (left_len - start));
+	if (!right) {
+		rc_unref(left);
+		return NULL;
+	}
+	return join_ropes(left, right);
+}
+
+const bc_rope *rope_substr(const bc_rope *rope, size_t start, size_t len)
+{
+	size_t total = rope_len(rope);
+	if (start >= total || !len) {
+		return NULL;
+	} else if (len > total - start) {
+		len = total - start;
+	}
+	return slice_rope(rope, start, len);
+}
+
+/* Output */
+
+typedef struct bc_rope_iter {
+	const bc_rope *stack[BC_ROPE_HEIGHT_MAX];
+	unsigned depth;
+} bc_rope_iter;
+
+static inline void init_iter(bc_rope_iter *iter, const bc_rope *rope)
+{
+	iter->depth = 0;
+	if (rope) {
+		iter->stack[iter->depth++] = rope;
+	}
+}
+
+static inline const bc_rope *next_leaf(bc_rope_iter *iter)
+{
+	while (iter->depth) {
+		const bc_rope *rope = iter->stack[--iter->depth];
+		if (is_leaf(rope)) {
+			return rope;
+		}
+		iter->stack[iter->depth++] = rope->right;
+		iter->stack[iter->depth++] = rope->left;
+	}
+	return NULL;
+}
+
+const bc_imm_str *rope_flatten(const bc_rope *rope)
+{
+	if (rope && is_leaf(rope) && rope->at == imm_str_read(rope->str) &&
+		rope->len == imm_str_len(rope->str)) {
+		return rc_ref(rope->str);
+	}
+
+	bc_imm_str *str = imm_str_alloc(rope_len(rope));
+	if (!str) {
+		return NULL;
+	}
+
+	char *dest = imm_str_write(str);
+	bc_rope_iter iter;
+	init_iter(&iter, rope);
+	for (const bc_rope *leaf; (leaf = next_leaf(&iter));) {
+		memcpy(dest, leaf->at, leaf->len);
+		dest += leaf->len;
+	}
+	return str;
+}
+
+static inline bool write_iov(int fd, struct iovec *iov, int count)
+{
+	while (count) {
+		ssize_t written = writev(fd, iov, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			error_sys(BC_ERROR_ABORT, errno, "Failed to write rope");
+			return false;
+		}
+
+		size_t remaining = (size_t)written;
+		while (count && remaining >= iov->iov_len) {
+			remaining -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count) {
+			iov->iov_base = (char *)iov->iov_base + remaining;
+			iov->iov_len -= remaining;
+		}
+	}
+	return true;
+}
+
+bool rope_write(const bc_rope *rope, FILE *f)
+{
+	if (fflush(f)) {
+		error_sys(BC_ERROR_ABORT, errno, "Failed to write rope");
+		return false;
+	}
+	return rope_write_fd(rope, fileno(f));
+}
+
+bool rope_write_fd(const bc_rope *rope, int fd)
+{
+	struct iovec iov[BC_ROPE_IOV_MAX];
+	bc_rope_iter iter;
+	init_iter(&iter, rope);
+
+	const bc_rope *leaf = next_leaf(&iter);
+	while (leaf) {
+		int count = 0;
+		for (; leaf && count < BC_ROPE_IOV_MAX; leaf = next_leaf(&iter)) {
+			iov[count++] = (struct iovec){
+				.iov_base = (void *)leaf->at,
+				.iov_len = leaf->len,
+			};
+		}
+
+		if (!write_iov(fd, iov, count)) {
+			return false;
+		}
+	}
+	return true;
+}
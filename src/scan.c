@@ -0,0 +1 @@
+#include "scan/scan.0.0.h"
@@ -0,0 +1,416 @@
+#include "scan.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_SCAN_SIMD
+#	if defined(__x86_64__) && defined(__GNUC__)
+#		define BC_SCAN_SIMD 1
+#	else
+#		define BC_SCAN_SIMD 0
+#	endif
+#endif
+
+#ifndef BC_SCAN_PROBE_LEN
+#	define BC_SCAN_PROBE_LEN 16
+#endif
+
+#if BC_SCAN_SIMD
+#	include <immintrin.h>
+#endif
+
+typedef struct bc_scan_impl {
+	const char *(*find_any)(
+		const char *at, const char *end, const char *set, size_t set_len);
+	const char *(*skip_ident)(const char *at, const char *end);
+	size_t (*count_newlines)(const char *at, const char *end);
+	size_t (*index_newlines)(const char *at, const char *end, size_t *dest);
+} bc_scan_impl;
+
+/* Scalar Scanning */
+
+static inline bool is_ident_byte(unsigned char byte)
+{
+	return (unsigned char)((byte | 0x20) - 'a') <= 'z' - 'a' ||
+		   (unsigned char)(byte - '0') <= '9' - '0' || byte == '_';
+}
+
+static const char *find_any_scalar(
+	const char *at, const char *end, const char *set, size_t set_len)
+{
+	bool is_member[UINT8_MAX + 1] = {0};
+	for (size_t i = 0; i < set_len; i++) {
+		is_member[(unsigned char)set[i]] = true;
+	}
+
+	while (at < end && !is_member[(unsigned char)*at]) {
+		at++;
+	}
+	return at;
+}
+
+static const char *skip_ident_scalar(const char *at, const char *end)
+{
+	while (at < end && is_ident_byte((unsigned char)*at)) {
+		at++;
+	}
+	return at;
+}
+
+static size_t count_newlines_scalar(const char *at, const char *end)
+{
+	size_t count = 0;
+	for (; at < end; at++) {
+		count += *at == '\n';
+	}
+	return count;
+}
+
+static size_t
+index_newlines_scalar(const char *at, const char *end, size_t *dest)
+{
+	size_t count = 0;
+	for (size_t i = 0; at + i < end; i++) {
+		if (at[i] == '\n') {
+			dest[count++] = i;
+		}
+	}
+	return count;
+}
+
+static const bc_scan_impl g_scan_scalar = {
+	.find_any = find_any_scalar,
+	.skip_ident = skip_ident_scalar,
+	.count_newlines = count_newlines_scalar,
+	.index_newlines = index_newlines_scalar,
+};
+
+#if BC_SCAN_SIMD
+
+/* SSE2 Scanning */
+
+__attribute__((target("sse2"))) static inline __m128i
+in_range_sse2(__m128i bytes, char low, char high)
+{
+	__m128i offset = _mm_sub_epi8(bytes, _mm_set1_epi8(low));
+	__m128i limit = _mm_set1_epi8((char)(high - low));
+	return _mm_cmpeq_epi8(_mm_min_epu8(offset, limit), offset);
+}
+
+__attribute__((target("sse2"))) static inline unsigned
+ident_mask_sse2(__m128i bytes)
+{
+	__m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+	__m128i ident = _mm_or_si128(
+		in_range_sse2(lower, 'a', 'z'), in_range_sse2(bytes, '0', '9'));
+	ident = _mm_or_si128(ident, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_')));
+	return (unsigned)_mm_movemask_epi8(ident);
+}
+
+__attribute__((target("sse2"))) static const char *find_any_sse2(
+	const char *at, const char *end, const char *set, size_t set_len)
+{
+	__m128i needles[BC_SCAN_SET_MAX];
+	for (size_t i = 0; i < set_len; i++) {
+		needles[i] = _mm_set1_epi8(set[i]);
+	}
+
+	for (; end - at >= 16; at += 16) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)at);
+		__m128i found = _mm_setzero_si128();
+		for (size_t i = 0; i < set_len; i++) {
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(bytes, needles[i]));
+		}
+
+		unsigned mask = (unsigned)_mm_movemask_epi8(found);
+		if (mask) {
+			return at + __builtin_ctz(mask);
+		}
+	}
+	return find_any_scalar(at, end, set, set_len);
+}
+
+__attribute__((target("sse2"))) static const char *
+skip_ident_sse2(const char *at, const char *end)
+{
+	for (; end - at >= 16; at += 16) {
+		unsigned mask =
+			~ident_mask_sse2(_mm_loadu_si128((const __m128i *)at)) & 0xffff;
+		if (mask) {
+			return at + __builtin_ctz(mask);
+		}
+	}
+	return skip_ident_scalar(at, end);
+}
+
+__attribute__((target("sse2"))) static size_t
+count_newlines_sse2(const char *at, const char *end)
+{
+	__m128i newline = _mm_set1_epi8('\n');
+	__m128i zero = _mm_setzero_si128();
+	size_t count = 0;
+	while (end - at >= 16) {
+		size_t blocks = (size_t)(end - at) / 16;
+		if (blocks > UINT8_MAX) {
+			blocks = UINT8_MAX;
+		}
+
+		__m128i acc = zero;
+		for (; blocks; blocks--, at += 16) {
+			__m128i bytes = _mm_loadu_si128((const __m128i *)at);
+			acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(bytes, newline));
+		}
+
+		__m128i sums = _mm_sad_epu8(acc, zero);
+		count += (size_t)_mm_cvtsi128_si64(sums) +
+				 (size_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+	}
+	return count + count_newlines_scalar(at, end);
+}
+
+__attribute__((target("sse2"))) static size_t
+index_newlines_sse2(const char *at, const char *end, size_t *dest)
+{
+	__m128i newline = _mm_set1_epi8('\n');
+	size_t count = 0;
+	size_t base = 0;
+	for (; end - (at + base) >= 16; base += 16) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(at + base));
+		unsigned mask =
+			(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline));
+		for (; mask; mask &= mask - 1) {
+			dest[count++] = base + (size_t)__builtin_ctz(mask);
+		}
+	}
+
+	size_t tail_count = index_newlines_scalar(at + base, end, dest + count);
+	for (size_t i = count; i < count + tail_count; i++) {
+		dest[i] += base;
+	}
+	return count + tail_count;
+}
+
+static const bc_scan_impl g_scan_sse2 = {
+	.find_any = find_any_sse2,
+	.skip_ident = skip_ident_sse2,
+	.count_newlines = count_newlines_sse2,
+	.index_newlines = index_newlines_sse2,
+};
+
+/* AVX2 Scanning */
+
+__attribute__((target("avx2"))) static inline __m256i
+in_range_avx2(__m256i bytes, char low, char high)
+{
+	__m256i offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8(low));
+	__m256i limit = _mm256_set1_epi8((char)(high - low));
+	return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, limit), offset);
+}
+
+__attribute__((target("avx2"))) static inline uint32_t
+ident_mask_avx2(__m256i bytes)
+{
+	__m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+	__m256i ident = _mm256_or_si256(
+		in_range_avx2(lower, 'a', 'z'), in_range_avx2(bytes, '0', '9'));
+	ident = _mm256_or_si256(
+		ident, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('_')));
+	return (uint32_t)_mm256_movemask_epi8(ident);
+}
+
+__attribute__((target("avx2"))) static const char *find_any_avx2(
+	const char *at, const char *end, const char *set, size_t set_len)
+{
+	__m256i needles[BC_SCAN_SET_MAX];
+	for (size_t i = 0; i < set_len; i++) {
+		needles[i] = _mm256_set1_epi8(set[i]);
+	}
+
+	for (; end - at >= 32; at += 32) {
+		__m256i bytes = _mm256_loadu_si256((const __m256i *)at);
+		__m256i found = _mm256_setzero_si256();
+		for (size_t i = 0; i < set_len; i++) {
+			found =
+				_mm256_or_si256(found, _mm256_cmpeq_epi8(bytes, needles[i]));
+		}
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(found);
+		if (mask) {
+			return at + __builtin_ctz(mask);
+		}
+	}
+	return find_any_sse2(at, end, set, set_len);
+}
+
+__attribute__((target("avx2"))) static const char *
+skip_ident_avx2(const char *at, const char *end)
+{
+	for (; end - at >= 32; at += 32) {
+		uint32_t mask =
+			~ident_mask_avx2(_mm256_loadu_si256((const __m256i *)at));
+		if (mask) {
+			return at + __builtin_ctz(mask);
+		}
+	}
+	return skip_ident_sse2(at, end);
+}
+
+__attribute__((target("avx2"))) static size_t
+count_newlines_avx2(const char *at, const char *end)
+{
+	__m256i newline = _mm256_set1_epi8('\n');
+	__m256i zero = _mm256_setzero_si256();
+	size_t count = 0;
+	while (end - at >= 32) {
+		size_t blocks = (size_t)(end - at) / 32;
+		if (blocks > UINT8_MAX) {
+			blocks = UINT8_MAX;
+		}
+
+		__m256i acc = zero;
+		for (; blocks; blocks--, at += 32) {
+			__m256i bytes = _mm256_loadu_si256((const __m256i *)at);
+			acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(bytes, newline));
+		}
+
+		__m256i sums = _mm256_sad_epu8(acc, zero);
+		count += (size_t)_mm256_extract_epi64(sums, 0) +
+				 (size_t)_mm256_extract_epi64(sums, 1) +
+				 (size_t)_mm256_extract_epi64(sums, 2) +
+				 (size_t)_mm256_extract_epi64(sums, 3);
+	}
+	return count + count_newlines_sse2(at, end);
+}
+
+__attribute__((target("avx2"))) static size_t
+index_newlines_avx2(const char *at, const char *end, size_t *dest)
+{
+	__m256i newline = _mm256_set1_epi8('\n');
+	size_t count = 0;
+	size_t base = 0;
+	for (; end - (at + base) >= 32; base += 32) {
+		__m256i bytes = _mm256_loadu_si256((const __m256i *)(at + base));
+		uint32_t mask =
+			(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, newline));
+		for (; mask; mask &= mask - 1) {
+			dest[count++] = base + (size_t)__builtin_ctz(mask);
+		}
+	}
+
+	size_t tail_count = index_newlines_sse2(at + base, end, dest + count);
+	for (size_t i = count; i < count + tail_count; i++) {
+		dest[i] += base;
+	}
+	return count + tail_count;
+}
+
+static const bc_scan_impl g_scan_avx2 = {
+	.find_any = find_any_avx2,
+	.skip_ident = skip_ident_avx2,
+	.count_newlines = count_newlines_avx2,
+	.index_newlines = index_newlines_avx2,
+};
+
+static const bc_scan_impl *select_impl(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return &g_scan_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		return &g_scan_sse2;
+	}
+	return &g_scan_scalar;
+}
+
+static const bc_scan_impl *find_impl(int impl)
+{
+	__builtin_cpu_init();
+	switch (impl) {
+	case BC_SCAN_IMPL_SCALAR:
+		return &g_scan_scalar;
+	case BC_SCAN_IMPL_SSE2:
+		return __builtin_cpu_supports("sse2") ? &g_scan_sse2 : NULL;
+	case BC_SCAN_IMPL_AVX2:
+		return __builtin_cpu_supports("avx2") ? &g_scan_avx2 : NULL;
+	default:
+		return NULL;
+	}
+}
+#else
+static const bc_scan_impl *select_impl(void)
+{
+	return &g_scan_scalar;
+}
+
+static const bc_scan_impl *find_impl(int impl)
+{
+	return impl == BC_SCAN_IMPL_SCALAR ? &g_scan_scalar : NULL;
+}
+#endif
+
+/* Scanning */
+
+static _Atomic(const bc_scan_impl *) g_scan_impl;
+
+static inline const bc_scan_impl *get_impl(void)
+{
+	const bc_scan_impl *impl =
+		atomic_load_explicit(&g_scan_impl, memory_order_relaxed);
+	if (!impl) {
+		impl = select_impl();
+		atomic_store_explicit(&g_scan_impl, impl, memory_order_relaxed);
+	}
+	return impl;
+}
+
+const char *scan_find_byte(const char *at, const char *end, char byte)
+{
+	const char *found = memchr(at, byte, (size_t)(end - at));
+	return found ? found : end;
+}
+
+const char *scan_find_any(
+	const char *at, const char *end, const char *set, size_t set_len)
+{
+	if (set_len > BC_SCAN_SET_MAX) {
+		return find_any_scalar(at, end, set, set_len);
+	}
+	return get_impl()->find_any(at, end, set, set_len);
+}
+
+const char *scan_skip_ident(const char *at, const char *end)
+{
+	const char *probe_end =
+		end - at > BC_SCAN_PROBE_LEN ? at + BC_SCAN_PROBE_LEN : end;
+	at = skip_ident_scalar(at, probe_end);
+	if (at < probe_end) {
+		return at;
+	}
+	return get_impl()->skip_ident(at, end);
+}
+
+size_t scan_count_newlines(const char *at, const char *end)
+{
+	return get_impl()->count_newlines(at, end);
+}
+
+size_t scan_index_newlines(const char *at, const char *end, size_t *dest)
+{
+	return get_impl()->index_newlines(at, end, dest);
+}
+
+/* Forces one kernel set, false if this CPU or build does not have it */
+bool scan_set_impl(int impl)
+{
+	const bc_scan_impl *found = find_impl(impl);
+	if (!found) {
+		return false;
+	}
+	atomic_store_explicit(&g_scan_impl, found, memory_order_relaxed);
+	return true;
+}
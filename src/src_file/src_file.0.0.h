@@ -1,17 +1,54 @@
 #include "error.h"
 #include "imm_str.h"
+#include "lock.h"
 #include "rc.h"
+#include "scan.h"
 #include "src_file.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
-#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#ifndef BC_SRC_FILE_MAP_MIN
+#	define BC_SRC_FILE_MAP_MIN 16384
+#endif
+
+#ifndef BC_SRC_FILE_CACHE_INIT_CAP
+#	define BC_SRC_FILE_CACHE_INIT_CAP 64
+#endif
+
+#ifndef BC_SRC_FILE_CACHE_MAX
+#	define BC_SRC_FILE_CACHE_MAX 4096
+#endif
+
+#ifndef BC_SRC_FILE_LOAD_THREADS
+#	define BC_SRC_FILE_LOAD_THREADS 8
+#endif
+
+#ifndef BC_SRC_FILE_READ_CHUNK
+#	define BC_SRC_FILE_READ_CHUNK 65536
+#endif
+
+typedef struct bc_src_file_lines {
+	size_t len;
+	size_t off[];
+} bc_src_file_lines;
 
 typedef struct bc_src_file {
 	const bc_imm_str *path;
 	const bc_imm_str *text;
+	_Atomic(const bc_src_file_lines *) lines;
+	atomic_uint_least32_t loc_base;
 } bc_src_file;
 
 const bc_imm_str *src_file_path(const bc_src_file *file)
@@ -24,37 +61,587 @@ const bc_imm_str *src_file_text(const bc_src_file *file)
 	return file->text;
 }
 
+uint32_t src_file_loc_base(const bc_src_file *file)
+{
+	return atomic_load_explicit(
+		&((bc_src_file *)file)->loc_base, memory_order_acquire);
+}
+
+void src_file_set_loc_base(const bc_src_file *file, uint32_t base)
+{
+	atomic_store_explicit(
+		&((bc_src_file *)file)->loc_base, base, memory_order_release);
+}
+
 static void
 src_file_visit(const void *src_file_ptr, void (*visitor)(const void *))
 {
 	const bc_src_file *file = src_file_ptr;
 	visitor(file->path);
 	visitor(file->text);
+	visitor(atomic_load_explicit(
+		&((bc_src_file *)file)->lines, memory_order_acquire));
+}
+
+/* Line Index */
+
+static inline const bc_src_file_lines *build_lines(const bc_imm_str *text)
+{
+	const char *at = imm_str_read(text);
+	const char *end = at + imm_str_len(text);
+	size_t count = scan_count_newlines(at, end) + 1;
+	bc_src_file_lines *lines =
+		rc_alloc(sizeof(*lines) + count * sizeof(*lines->off), NULL);
+	if (!lines) {
+		return NULL;
+	}
+
+	lines->len = count;
+	lines->off[0] = 0;
+	scan_index_newlines(at, end, lines->off + 1);
+	for (size_t i = 1; i < count; i++) {
+		lines->off[i]++;
+	}
+
+	return lines;
+}
+
+static inline const bc_src_file_lines *get_lines(const bc_src_file *file)
+{
+	bc_src_file *mut_file = (bc_src_file *)file;
+	const bc_src_file_lines *lines =
+		atomic_load_explicit(&mut_file->lines, memory_order_acquire);
+	if (lines) {
+		return lines;
+	}
+
+	lines = build_lines(file->text);
+	if (!lines) {
+		return NULL;
+	}
+
+	const bc_src_file_lines *prev_lines = NULL;
+	if (!atomic_compare_exchange_strong_explicit(
+			&mut_file->lines, &prev_lines, lines, memory_order_acq_rel,
+			memory_order_acquire)) {
+		rc_unref(lines);
+		return prev_lines;
+	}
+	return lines;
+}
+
+size_t src_file_line_count(const bc_src_file *file)
+{
+	const bc_src_file_lines *lines = get_lines(file);
+	return lines ? lines->len : 0;
 }
 
-static inline bool get_file_len(size_t *dest, FILE *f)
+bool src_file_get_pos(
+	size_t *line_dest, size_t *col_dest, const bc_src_file *file,
+	const char *at)
 {
-	long retval = fseek(f, 0, SEEK_END);
-	if (retval) {
-		errno = (int)retval;
+	const bc_src_file_lines *lines = get_lines(file);
+	if (!lines) {
 		return false;
 	}
 
-	retval = ftell(f);
+	size_t offset = (size_t)(at - imm_str_read(file->text));
+	size_t low = 0;
+	size_t high = lines->len;
+	while (high - low > 1) {
+		size_t mid = low + (high - low) / 2;
+		if (lines->off[mid] <= offset) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+
+	*line_dest = low + 1;
+	*col_dest = offset - lines->off[low] + 1;
+	return true;
+}
+
+static inline bool read_fd(int fd, char *dest, size_t len, size_t *read_len)
+{
+	size_t at = 0;
+	while (at < len) {
+		ssize_t retval = read(fd, dest + at, len - at);
+		if (retval < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		} else if (!retval) {
+			break;
+		}
+		at += (size_t)retval;
+	}
+
+	*read_len = at;
+	return true;
+}
+
+static inline const bc_imm_str *read_regular(int fd, size_t len)
+{
+	bc_imm_str *text = imm_str_alloc(len);
+	if (!text) {
+		return NULL;
+	}
+
+	size_t read_len;
+	if (!read_fd(fd, imm_str_write(text), len, &read_len)) {
+		rc_unref(text);
+		return NULL;
+	} else if (read_len < len) {
+		errno = EIO;
+		rc_unref(text);
+		return NULL;
+	}
+
+	return text;
+}
+
+static inline const bc_src_file *
+create_file(const bc_imm_str *path, const bc_imm_str *text)
+{
+	bc_src_file *file = rc_alloc(sizeof(bc_src_file), src_file_visit);
+	if (!file) {
+		rc_unref(path);
+		rc_unref(text);
+		return NULL;
+	}
+
+	file->path = path;
+	file->text = text;
+	atomic_init(&file->lines, NULL);
+	atomic_init(&file->loc_base, 0);
+	return file;
+}
+
+/* Streaming */
+
+typedef struct bc_src_stream {
+	const bc_imm_str *path;
+	int fd;
+	bool failed;
+	bool eof;
+	size_t len;
+	bc_imm_str *text;
+} bc_src_stream;
+
+static inline void
+init_stream(bc_src_stream *stream, const bc_imm_str *path, int fd)
+{
+	stream->path = path;
+	stream->fd = fd;
+	stream->failed = false;
+	stream->eof = false;
+	stream->len = 0;
+	stream->text = NULL;
+}
+
+static inline bool reserve_stream(bc_src_stream *stream)
+{
+	size_t cap = stream->text ? imm_str_len(stream->text) : 0;
+	if (cap - stream->len >= BC_SRC_FILE_READ_CHUNK) {
+		return true;
+	}
+
+	size_t next_cap = cap ? 2 * cap : BC_SRC_FILE_READ_CHUNK;
+	stream->text = imm_str_resize(stream->text, next_cap);
+	return stream->text;
+}
+
+static inline size_t read_chunk(bc_src_stream *stream)
+{
+	if (stream->failed || stream->eof) {
+		return 0;
+	} else if (!reserve_stream(stream)) {
+		stream->failed = true;
+		return 0;
+	}
+
+	char *dest = imm_str_write(stream->text) + stream->len;
+	size_t cap = imm_str_len(stream->text) - stream->len;
+	ssize_t retval;
+	do {
+		retval = read(stream->fd, dest, cap);
+	} while (retval < 0 && errno == EINTR);
+
 	if (retval < 0) {
+		stream->failed = true;
+		return 0;
+	} else if (!retval) {
+		stream->eof = true;
+		return 0;
+	}
+
+	stream->len += (size_t)retval;
+	return (size_t)retval;
+}
+
+static inline const bc_imm_str *finish_text(bc_src_stream *stream)
+{
+	while (read_chunk(stream)) {
+	}
+
+	bc_imm_str *text = stream->text;
+	stream->text = NULL;
+	if (stream->failed) {
+		rc_unref(text);
+		return NULL;
+	}
+	return imm_str_resize(text, stream->len);
+}
+
+bc_src_stream *src_stream_open(const char *path_src)
+{
+	int fd = open(path_src, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		error_sys(BC_ERROR_ABORT, errno, "Failed to open file '%s'", path_src);
+		return NULL;
+	}
+	return src_stream_open_fd(path_src, fd);
+}
+
+bc_src_stream *src_stream_open_fd(const char *path_src, int fd)
+{
+	const bc_imm_str *path = imm_str_create(path_src);
+	if (!path) {
+		close(fd);
+		return NULL;
+	}
+
+	bc_src_stream *stream = malloc(sizeof(*stream));
+	if (!stream) {
+		error_alloc(sizeof(*stream));
+		rc_unref(path);
+		close(fd);
+		return NULL;
+	}
+
+	init_stream(stream, path, fd);
+	return stream;
+}
+
+static inline void report_stream(const bc_src_stream *stream, bool failed)
+{
+	if (stream->failed && !failed) {
+		error_sys(
+			BC_ERROR_ABORT, errno, "Failed to read file '%s'",
+			imm_str_read(stream->path));
+	}
+}
+
+bool src_stream_next(
+	bc_src_stream *stream, const char **chunk_dest, size_t *len_dest)
+{
+	bool failed = stream->failed;
+	size_t prev_len = stream->len;
+	*len_dest = read_chunk(stream);
+	*chunk_dest = *len_dest ? imm_str_read(stream->text) + prev_len : NULL;
+	report_stream(stream, failed);
+	return *len_dest;
+}
+
+const char *src_stream_text(const bc_src_stream *stream, size_t *len_dest)
+{
+	*len_dest = stream->len;
+	return stream->text ? imm_str_read(stream->text) : NULL;
+}
+
+const bc_src_file *src_stream_finish(bc_src_stream *stream)
+{
+	bool failed = stream->failed;
+	const bc_imm_str *text = finish_text(stream);
+	report_stream(stream, failed);
+	const bc_src_file *file = NULL;
+	if (text) {
+		file = create_file(rc_ref(stream->path), text);
+	}
+	src_stream_close(stream);
+	return file;
+}
+
+void src_stream_close(bc_src_stream *stream)
+{
+	if (!stream) {
+		return;
+	}
+
+	close(stream->fd);
+	rc_unref(stream->text);
+	rc_unref(stream->path);
+	free(stream);
+}
+
+static inline const bc_imm_str *read_stream(const bc_imm_str *path, int fd)
+{
+	bc_src_stream stream;
+	init_stream(&stream, path, fd);
+	return finish_text(&stream);
+}
+
+static inline const bc_imm_str *
+read_text(const bc_imm_str *path, int fd, const struct stat *st)
+{
+	if (!S_ISREG(st->st_mode)) {
+		return read_stream(path, fd);
+	}
+
+	size_t len = (size_t)st->st_size;
+	if (len < BC_SRC_FILE_MAP_MIN) {
+		return read_regular(fd, len);
+	}
+
+	posix_fadvise(fd, 0, (off_t)len, POSIX_FADV_WILLNEED);
+	return imm_str_map(fd, len);
+}
+
+/* Cache */
+
+typedef struct bc_src_file_stamp {
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtime;
+	off_t size;
+} bc_src_file_stamp;
+
+typedef struct bc_src_file_slot {
+	const bc_imm_str *path;
+	const bc_src_file *file;
+	bc_src_file_stamp stamp;
+	size_t used;
+} bc_src_file_slot;
+
+/* Eviction goes by least recent use, not by who else holds a file. Callers
+ * and the location table (once a file is encoded) keep evicted files alive,
+ * but the next load of that path reads it again. */
+static bc_lock g_cache_lock = BC_LOCK_INIT;
+static size_t g_cache_len;
+static size_t g_cache_cap;
+static size_t g_cache_max = BC_SRC_FILE_CACHE_MAX;
+static size_t g_cache_tick;
+static bc_src_file_slot *g_cache_slots;
+
+static inline void init_stamp(bc_src_file_stamp *stamp, const struct stat *st)
+{
+	stamp->dev = st->st_dev;
+	stamp->ino = st->st_ino;
+	stamp->mtime = st->st_mtim;
+	stamp->size = st->st_size;
+}
+
+static inline bool
+is_stamp_equal(const bc_src_file_stamp *a, const bc_src_file_stamp *b)
+{
+	return a->dev == b->dev && a->ino == b->ino &&
+		   a->mtime.tv_sec == b->mtime.tv_sec &&
+		   a->mtime.tv_nsec == b->mtime.tv_nsec && a->size == b->size;
+}
+
+static inline bc_src_file_slot *find_slot(
+	bc_src_file_slot *slots, size_t cap, const bc_imm_str *path)
+{
+	size_t mask = cap - 1;
+	for (size_t i = imm_str_hash(path) & mask;; i = (i + 1) & mask) {
+		bc_src_file_slot *slot = &slots[i];
+		if (!slot->path || imm_str_equal(slot->path, path)) {
+			return slot;
+		}
+	}
+}
+
+static int compare_used(const void *a_ptr, const void *b_ptr)
+{
+	size_t a = *(const size_t *)a_ptr;
+	size_t b = *(const size_t *)b_ptr;
+	return (a < b) - (a > b);
+}
+
+/* Slots used before the returned tick are evicted to keep at most keep */
+static inline bool get_evict_tick(size_t *tick_dest, size_t keep)
+{
+	if (g_cache_len <= keep) {
+		*tick_dest = 0;
+		return true;
+	} else if (!keep) {
+		*tick_dest = SIZE_MAX;
+		return true;
+	}
+
+	size_t *used = malloc(g_cache_len * sizeof(*used));
+	if (!used) {
+		error_alloc(g_cache_len * sizeof(*used));
 		return false;
 	}
-	*dest = (size_t)retval;
 
-	retval = fseek(f, 0, SEEK_SET);
-	if (retval) {
-		errno = (int)retval;
+	size_t len = 0;
+	for (size_t i = 0; i < g_cache_cap; i++) {
+		if (g_cache_slots[i].path) {
+			used[len++] = g_cache_slots[i].used;
+		}
+	}
+	qsort(used, len, sizeof(*used), compare_used);
+	*tick_dest = used[keep - 1];
+	free(used);
+	return true;
+}
+
+static inline bool rebuild_cache(size_t keep, size_t extra)
+{
+	size_t evict_tick;
+	if (!get_evict_tick(&evict_tick, keep)) {
 		return false;
 	}
 
+	size_t len = g_cache_len < keep ? g_cache_len : keep;
+	size_t cap = BC_SRC_FILE_CACHE_INIT_CAP;
+	while ((len + extra) * 2 > cap) {
+		cap *= 2;
+	}
+
+	bc_src_file_slot *slots = calloc(cap, sizeof(*slots));
+	if (!slots) {
+		error_alloc(cap * sizeof(*slots));
+		return false;
+	}
+
+	for (size_t i = 0; i < g_cache_cap; i++) {
+		const bc_src_file_slot *slot = &g_cache_slots[i];
+		if (!slot->path) {
+			continue;
+		} else if (slot->used < evict_tick) {
+			rc_unref(slot->path);
+			rc_unref(slot->file);
+			continue;
+		}
+		*find_slot(slots, cap, slot->path) = *slot;
+	}
+
+	free(g_cache_slots);
+	g_cache_slots = slots;
+	g_cache_cap = cap;
+	g_cache_len = len;
 	return true;
 }
 
+static inline const bc_src_file *
+find_cached(const bc_imm_str *path, const bc_src_file_stamp *stamp)
+{
+	const bc_src_file *file = NULL;
+	lock_acquire(&g_cache_lock);
+	if (g_cache_cap) {
+		bc_src_file_slot *slot = find_slot(g_cache_slots, g_cache_cap, path);
+		if (slot->path && is_stamp_equal(&slot->stamp, stamp)) {
+			slot->used = ++g_cache_tick;
+			file = rc_ref(slot->file);
+		}
+	}
+	lock_release(&g_cache_lock);
+	return file;
+}
+
+static inline bool reserve_slot(void)
+{
+	if (g_cache_len >= g_cache_max) {
+		return rebuild_cache(g_cache_max / 2, 1);
+	} else if ((g_cache_len + 1) * 4 > g_cache_cap * 3) {
+		return rebuild_cache(g_cache_len, 1);
+	}
+	return true;
+}
+
+/* Takes over the reference to path */
+static inline const bc_src_file *insert_cached(
+	const bc_imm_str *path, const bc_src_file_stamp *stamp,
+	const bc_src_file *file)
+{
+	lock_acquire(&g_cache_lock);
+	bc_src_file_slot *slot = NULL;
+	if (g_cache_cap) {
+		slot = find_slot(g_cache_slots, g_cache_cap, path);
+	}
+
+	if (slot && slot->path && is_stamp_equal(&slot->stamp, stamp)) {
+		slot->used = ++g_cache_tick;
+		const bc_src_file *cached = rc_ref(slot->file);
+		lock_release(&g_cache_lock);
+		rc_unref(path);
+		rc_unref(file);
+		return cached;
+	} else if (slot && slot->path) {
+		rc_unref(slot->path);
+		rc_unref(slot->file);
+	} else if (!g_cache_max || !reserve_slot()) {
+		lock_release(&g_cache_lock);
+		rc_unref(path);
+		return file;
+	} else {
+		slot = find_slot(g_cache_slots, g_cache_cap, path);
+		g_cache_len++;
+	}
+
+	slot->path = path;
+	slot->file = rc_ref(file);
+	slot->stamp = *stamp;
+	slot->used = ++g_cache_tick;
+	lock_release(&g_cache_lock);
+	return file;
+}
+
+void src_file_cache_trim(void)
+{
+	lock_acquire(&g_cache_lock);
+	rebuild_cache(0, 0);
+	lock_release(&g_cache_lock);
+}
+
+void src_file_cache_set_max(size_t max)
+{
+	lock_acquire(&g_cache_lock);
+	g_cache_max = max;
+	if (g_cache_len > max) {
+		rebuild_cache(max, 0);
+	}
+	lock_release(&g_cache_lock);
+}
+
+/* Loading */
+
+static inline const bc_src_file *
+load_file(const bc_imm_str *path, bc_src_file_stamp *stamp)
+{
+	const char *path_read = imm_str_read(path);
+	int fd = open(path_read, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		error_sys(BC_ERROR_ABORT, errno, "Failed to open file '%s'", path_read);
+		rc_unref(path);
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st)) {
+		error_sys(BC_ERROR_ABORT, errno, "Failed to open file '%s'", path_read);
+		rc_unref(path);
+		close(fd);
+		return NULL;
+	}
+	init_stamp(stamp, &st);
+
+	const bc_imm_str *text = read_text(path, fd, &st);
+	if (!text) {
+		error_sys(BC_ERROR_ABORT, errno, "Failed to read file '%s'", path_read);
+		rc_unref(path);
+		close(fd);
+		return NULL;
+	}
+
+	close(fd);
+	return create_file(path, text);
+}
+
 const bc_src_file *src_file_load(const char *path_src)
 {
 	return src_file_load_n(path_src, strlen(path_src));
@@ -68,47 +655,132 @@ const bc_src_file *src_file_load_n(const char *path_src, size_t path_len)
 	}
 
 	const char *path_read = imm_str_read(path);
-	FILE *f = fopen(path_read, "rb");
-	if (!f) {
-		error_sys(BC_ERROR_ABORT, errno, "Failed to open file '%s'", path_read);
+	char *real_path = realpath(path_read, NULL);
+	struct stat st;
+	if (!real_path || stat(real_path, &st) || !S_ISREG(st.st_mode)) {
+		free(real_path);
+		bc_src_file_stamp stamp;
+		return load_file(path, &stamp);
+	}
+
+	const bc_imm_str *key = imm_str_create(real_path);
+	free(real_path);
+	if (!key) {
 		rc_unref(path);
 		return NULL;
 	}
 
-	bc_src_file *file = rc_alloc(sizeof(bc_src_file), src_file_visit);
-	if (!file) {
-		error_sys(BC_ERROR_ABORT, errno, "Failed to open file '%s'", path_read);
+	bc_src_file_stamp stamp;
+	init_stamp(&stamp, &st);
+	const bc_src_file *file = find_cached(key, &stamp);
+	if (file) {
 		rc_unref(path);
-		fclose(f);
+		rc_unref(key);
+		return file;
+	}
+
+	file = load_file(path, &stamp);
+	if (!file) {
+		rc_unref(key);
 		return NULL;
 	}
+	return insert_cached(key, &stamp, file);
+}
 
-	memset(file, 0, sizeof(*file));
-	file->path = path;
+/* Batch Loading */
 
-	size_t text_len;
-	if (!get_file_len(&text_len, f)) {
-		error_sys(BC_ERROR_ABORT, errno, "Failed to open file '%s'", path_read);
-		rc_unref(file);
-		fclose(f);
-		return NULL;
+typedef struct bc_src_file_done {
+	size_t index;
+	const bc_src_file *file;
+} bc_src_file_done;
+
+typedef struct bc_src_file_batch {
+	const char *const *paths;
+	size_t count;
+	atomic_size_t next;
+	mtx_t mtx;
+	cnd_t cnd;
+	size_t done_len;
+	bc_src_file_done *done;
+} bc_src_file_batch;
+
+static int run_loader(void *batch_ptr)
+{
+	bc_src_file_batch *batch = batch_ptr;
+	size_t i;
+	while ((i = atomic_fetch_add_explicit(
+				&batch->next, 1, memory_order_relaxed)) < batch->count) {
+		const bc_src_file *file = src_file_load(batch->paths[i]);
+
+		mtx_lock(&batch->mtx);
+		batch->done[batch->done_len++] = (bc_src_file_done){i, file};
+		cnd_signal(&batch->cnd);
+		mtx_unlock(&batch->mtx);
 	}
+	return 0;
+}
 
-	file->text = imm_str_from_file(f, text_len);
-	if (!file->text) {
-		if (ferror(f)) {
-			error_msg(
-				BC_ERROR_ABORT,
-				"Failed to open file '%s': fread encountered an error");
-		} else {
-			error_msg(BC_ERROR_ABORT, "Failed to open file '%s'", path_read);
+bool src_file_load_many(
+	const char *const *paths, size_t count, bc_src_file_loaded callback,
+	void *arg)
+{
+	if (!count) {
+		return true;
+	}
+
+	bc_src_file_batch batch = {.paths = paths, .count = count};
+	atomic_init(&batch.next, 0);
+	batch.done = malloc(count * sizeof(*batch.done));
+	if (!batch.done) {
+		error_alloc(count * sizeof(*batch.done));
+		return false;
+	}
+
+	if (mtx_init(&batch.mtx, mtx_plain) != thrd_success) {
+		error_msg(BC_ERROR_ABORT, "Failed to create loader mutex");
+		free(batch.done);
+		return false;
+	} else if (cnd_init(&batch.cnd) != thrd_success) {
+		error_msg(BC_ERROR_ABORT, "Failed to create loader condition");
+		mtx_destroy(&batch.mtx);
+		free(batch.done);
+		return false;
+	}
+
+	thrd_t loaders[BC_SRC_FILE_LOAD_THREADS];
+	size_t loader_count = 0;
+	while (loader_count < BC_SRC_FILE_LOAD_THREADS &&
+		   loader_count < count &&
+		   thrd_create(&loaders[loader_count], run_loader, &batch) ==
+			   thrd_success) {
+		loader_count++;
+	}
+
+	if (!loader_count) {
+		run_loader(&batch);
+	}
+
+	size_t handled = 0;
+	while (handled < count) {
+		mtx_lock(&batch.mtx);
+		while (handled == batch.done_len) {
+			cnd_wait(&batch.cnd, &batch.mtx);
+		}
+		size_t done_len = batch.done_len;
+		mtx_unlock(&batch.mtx);
+
+		for (; handled < done_len; handled++) {
+			const bc_src_file_done *done = &batch.done[handled];
+			callback(arg, done->index, done->file);
 		}
-		rc_unref(file);
-		fclose(f);
-		return NULL;
 	}
 
-	fclose(f);
+	for (size_t i = 0; i < loader_count; i++) {
+		thrd_join(loaders[i], NULL);
+	}
 
-	return file;
+	cnd_destroy(&batch.cnd);
+	mtx_destroy(&batch.mtx);
+	free(batch.done);
+	return true;
 }
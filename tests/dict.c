@@ -0,0 +1,162 @@
+#include "dict.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define KEY_COUNT 2000
+
+static char g_keys[KEY_COUNT][48];
+static size_t g_key_lens[KEY_COUNT];
+
+static size_t *create_value(size_t value)
+{
+	size_t *ptr = rc_alloc(sizeof(*ptr), NULL);
+	TEST_ASSERT(ptr);
+	*ptr = value;
+	return ptr;
+}
+
+static void check_value(const bc_dict *dict, size_t i, size_t value)
+{
+	const bc_dict *node = dict_find(dict, g_keys[i], g_key_lens[i]);
+	TEST_ASSERT(node);
+	TEST_ASSERT(*(const size_t *)dict_node_value(node) == value);
+
+	const bc_imm_str_slice *key = dict_node_key(node);
+	TEST_ASSERT(imm_str_slice_len(key) == g_key_lens[i]);
+	TEST_ASSERT(!memcmp(imm_str_slice_read(key), g_keys[i], g_key_lens[i]));
+}
+
+static void check_count(const bc_dict *dict, size_t count)
+{
+	bc_dict_stats stats;
+	TEST_ASSERT(dict_stats(dict, &stats));
+	TEST_ASSERT(stats.count == count);
+}
+
+static void test_persistent(void)
+{
+	const bc_dict *dict = NULL;
+	for (size_t i = 0; i < KEY_COUNT; i += 2) {
+		TEST_ASSERT(
+			dict_define(&dict, g_keys[i], g_key_lens[i], create_value(i)));
+	}
+
+	/* Older versions are unaffected by edits to newer ones */
+	const bc_dict *old = rc_ref(dict);
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		TEST_ASSERT(dict_define(
+			&dict, g_keys[i], g_key_lens[i], create_value(i + KEY_COUNT)));
+	}
+	for (size_t i = 0; i < KEY_COUNT; i += 4) {
+		dict_delete(&dict, g_keys[i], g_key_lens[i]);
+	}
+
+	check_count(old, KEY_COUNT / 2);
+	check_count(dict, KEY_COUNT - KEY_COUNT / 4);
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		if (i % 2 == 0) {
+			check_value(old, i, i);
+		} else {
+			TEST_ASSERT(!dict_find(old, g_keys[i], g_key_lens[i]));
+		}
+
+		if (i % 4 == 0) {
+			TEST_ASSERT(!dict_find(dict, g_keys[i], g_key_lens[i]));
+		} else {
+			check_value(dict, i, i + KEY_COUNT);
+		}
+	}
+
+	rc_unref(old);
+	rc_unref(dict);
+}
+
+static void test_transient(void)
+{
+	const bc_dict *base = NULL;
+	for (size_t i = 0; i < KEY_COUNT / 2; i++) {
+		TEST_ASSERT(
+			dict_define(&base, g_keys[i], g_key_lens[i], create_value(i)));
+	}
+
+	/* Editing a shared dict must leave the original intact */
+	bc_dict_transient trans;
+	dict_transient_init(&trans, rc_ref(base));
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		TEST_ASSERT(dict_transient_define(
+			&trans, g_keys[i], g_key_lens[i], create_value(2 * i)));
+	}
+	for (size_t i = 1; i < KEY_COUNT; i += 3) {
+		dict_transient_delete(&trans, g_keys[i], g_key_lens[i]);
+	}
+	const bc_dict *dict = dict_transient_freeze(&trans);
+	TEST_ASSERT(!trans.root);
+
+	check_count(base, KEY_COUNT / 2);
+	for (size_t i = 0; i < KEY_COUNT / 2; i++) {
+		check_value(base, i, i);
+	}
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		if (i % 3 == 1) {
+			TEST_ASSERT(!dict_find(dict, g_keys[i], g_key_lens[i]));
+		} else {
+			check_value(dict, i, 2 * i);
+		}
+	}
+	rc_unref(base);
+
+	/* Once uniquely owned, overwrites happen in place */
+	dict_transient_init(&trans, dict);
+	const bc_dict *node = dict_find(trans.root, g_keys[0], g_key_lens[0]);
+	const bc_dict *root = trans.root;
+	TEST_ASSERT(
+		dict_transient_define(
+			&trans, g_keys[0], g_key_lens[0], create_value(7)) == node);
+	TEST_ASSERT(trans.root == root);
+	dict = dict_transient_freeze(&trans);
+	check_value(dict, 0, 7);
+	rc_unref(dict);
+}
+
+/* Priorities come from the key hash, so the shape ignores insertion order */
+static void test_shape(void)
+{
+	const bc_dict *forward = NULL;
+	const bc_dict *backward = NULL;
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		size_t j = KEY_COUNT - 1 - i;
+		TEST_ASSERT(dict_define(&forward, g_keys[i], g_key_lens[i], NULL));
+		TEST_ASSERT(dict_define(&backward, g_keys[j], g_key_lens[j], NULL));
+	}
+
+	bc_dict_stats forward_stats, backward_stats;
+	TEST_ASSERT(dict_stats(forward, &forward_stats));
+	TEST_ASSERT(dict_stats(backward, &backward_stats));
+	TEST_ASSERT(forward_stats.count == KEY_COUNT);
+	TEST_ASSERT(forward_stats.max_depth == backward_stats.max_depth);
+	TEST_ASSERT(forward_stats.avg_depth == backward_stats.avg_depth);
+	TEST_ASSERT(forward_stats.max_depth < 64);
+
+	rc_unref(forward);
+	rc_unref(backward);
+}
+
+int main(void)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		const char *fmt = i % 2 ? "k%zu" : "a_much_longer_identifier_%zu";
+		g_key_lens[i] = (size_t)snprintf(
+			g_keys[i], sizeof(g_keys[i]), fmt, i * 7919 % KEY_COUNT);
+	}
+
+	test_persistent();
+	test_transient();
+	test_shape();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#include "ctx.h"
+#include "error.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "src_file.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define OUTPUT_MAX 4096
+
+static const char g_text[] = "int a;\nint b;\nint c;\n";
+
+static FILE *g_capture;
+static int g_stderr;
+
+static void begin_capture(void)
+{
+	g_capture = tmpfile();
+	TEST_ASSERT(g_capture);
+	g_stderr = dup(STDERR_FILENO);
+	TEST_ASSERT(g_stderr >= 0);
+	TEST_ASSERT(dup2(fileno(g_capture), STDERR_FILENO) >= 0);
+}
+
+static void end_capture(char *dest)
+{
+	error_flush();
+	TEST_ASSERT(dup2(g_stderr, STDERR_FILENO) >= 0);
+	close(g_stderr);
+
+	rewind(g_capture);
+	size_t len = fread(dest, 1, OUTPUT_MAX - 1, g_capture);
+	dest[len] = '\0';
+	fclose(g_capture);
+}
+
+static const bc_src_file *load_text(void)
+{
+	char path[] = "/tmp/bc_error_filter_XXXXXX";
+	int fd = mkstemp(path);
+	TEST_ASSERT(fd >= 0);
+	TEST_ASSERT(write(fd, g_text, sizeof(g_text) - 1) ==
+				(ssize_t)sizeof(g_text) - 1);
+	close(fd);
+
+	const bc_src_file *file = src_file_load(path);
+	unlink(path);
+	TEST_ASSERT(file);
+	return file;
+}
+
+int main(void)
+{
+	static const char unused_fmt[] = "unused variable '%s'";
+	char unused_copy[sizeof(unused_fmt)];
+	memcpy(unused_copy, unused_fmt, sizeof(unused_fmt));
+
+	const bc_src_file *file = load_text();
+	const char *at = imm_str_read(src_file_text(file));
+	bc_ctx first, second;
+	ctx_init(&first, file, at + 4, 1);
+	ctx_init(&second, file, at + 11, 1);
+
+	/* Categories match on level and format text, not the pointer */
+	error_suppress_fmt(BC_ERROR_WARN, unused_copy, true);
+	error_suppress_at(&second, true);
+	error_suppress(-1, true);
+	error_suppress(64, true);
+	TEST_ASSERT(error_enabled(-1));
+	TEST_ASSERT(error_enabled(64));
+
+	char out[OUTPUT_MAX];
+	begin_capture();
+	error_at(BC_ERROR_WARN, &first, unused_fmt, "a");
+	error_at(BC_ERROR_NOTE, &first, unused_fmt, "kept note");
+	error_at(BC_ERROR_WARN, &first, "shadowed '%s'", "kept warning");
+	error_at(BC_ERROR_ABORT, &second, "muted location");
+	error_msg(BC_ERROR_WARN, "no location");
+	end_capture(out);
+
+	TEST_ASSERT(!strstr(out, "'a'"));
+	TEST_ASSERT(strstr(out, "kept note"));
+	TEST_ASSERT(strstr(out, "kept warning"));
+	TEST_ASSERT(!strstr(out, "muted location"));
+	TEST_ASSERT(strstr(out, "no location"));
+
+	error_suppress_fmt(BC_ERROR_WARN, unused_fmt, false);
+	error_suppress_at(&second, false);
+	begin_capture();
+	error_at(BC_ERROR_WARN, &first, unused_fmt, "b");
+	error_at(BC_ERROR_ABORT, &second, "unmuted location");
+	end_capture(out);
+
+	TEST_ASSERT(strstr(out, "'b'"));
+	TEST_ASSERT(strstr(out, "unmuted location"));
+
+	/* Dedup and limits agree with suppression on two copies of a format */
+	error_set_dedup(true);
+	begin_capture();
+	error_at(BC_ERROR_WARN, &first, unused_fmt, "c");
+	error_at(BC_ERROR_WARN, &first, unused_copy, "c");
+	end_capture(out);
+
+	const char *kept = strstr(out, "'c'");
+	TEST_ASSERT(kept && !strstr(kept + 1, "'c'"));
+	TEST_ASSERT(strstr(out, "1 duplicate diagnostics suppressed"));
+
+	error_set_dedup(false);
+	error_set_limit(1);
+	begin_capture();
+	error_at(BC_ERROR_WARN, &first, unused_fmt, "d");
+	error_at(BC_ERROR_WARN, &second, unused_copy, "e");
+	end_capture(out);
+	error_set_limit(0);
+
+	TEST_ASSERT(strstr(out, "'d'"));
+	TEST_ASSERT(!strstr(out, "'e'"));
+	TEST_ASSERT(strstr(out, "1 more warning diagnostics like"));
+
+	rc_unref(file);
+	return EXIT_SUCCESS;
+}
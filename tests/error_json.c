@@ -0,0 +1,238 @@
+#include "ctx.h"
+#include "error.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "src_file.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define OUTPUT_MAX 8192
+
+/* Quotes, backslashes, control characters, a valid two- and four-byte
+ * sequence, then a stray byte, a truncated lead, an overlong encoding and
+ * an encoded surrogate */
+static const char g_message[] =
+	"quote \" slash \\ tab \t nl \n ctl \x01\x1f del \x7f ok \xc3\xa9 "
+	"\xf0\x9f\x98\x80 bad \xff trunc \xc3 over \xc0\xaf sur \xed\xa0\x80 end";
+
+static FILE *g_capture;
+static int g_stderr;
+
+static void begin_capture(void)
+{
+	g_capture = tmpfile();
+	TEST_ASSERT(g_capture);
+	g_stderr = dup(STDERR_FILENO);
+	TEST_ASSERT(g_stderr >= 0);
+	TEST_ASSERT(dup2(fileno(g_capture), STDERR_FILENO) >= 0);
+}
+
+static size_t end_capture(char *dest)
+{
+	error_flush();
+	TEST_ASSERT(dup2(g_stderr, STDERR_FILENO) >= 0);
+	close(g_stderr);
+
+	rewind(g_capture);
+	size_t len = fread(dest, 1, OUTPUT_MAX - 1, g_capture);
+	dest[len] = '\0';
+	fclose(g_capture);
+	return len;
+}
+
+/* A minimal JSON checker: strings must hold no raw control characters,
+ * only valid escapes and only well-formed UTF-8 */
+
+static bool parse_value(const char **src);
+
+static void skip_space(const char **src)
+{
+	while (**src && strchr(" \t\r\n", **src)) {
+		(*src)++;
+	}
+}
+
+static bool parse_utf8(const char **src)
+{
+	const unsigned char *at = (const unsigned char *)*src;
+	size_t len = at[0] >= 0xf0 ? 4 : at[0] >= 0xe0 ? 3 : 2;
+	if (at[0] < 0xc2 || at[0] > 0xf4) {
+		return false;
+	}
+	for (size_t i = 1; i < len; i++) {
+		if ((at[i] & 0xc0) != 0x80) {
+			return false;
+		}
+	}
+	if ((at[0] == 0xe0 && at[1] < 0xa0) || (at[0] == 0xed && at[1] > 0x9f) ||
+		(at[0] == 0xf0 && at[1] < 0x90) || (at[0] == 0xf4 && at[1] > 0x8f)) {
+		return false;
+	}
+	*src += len;
+	return true;
+}
+
+static bool parse_string(const char **src)
+{
+	if (*(*src)++ != '"') {
+		return false;
+	}
+	for (;;) {
+		unsigned char c = (unsigned char)**src;
+		if (c == '"') {
+			(*src)++;
+			return true;
+		} else if (c < 0x20) {
+			return false;
+		} else if (c >= 0x80) {
+			if (!parse_utf8(src)) {
+				return false;
+			}
+			continue;
+		} else if (c != '\\') {
+			(*src)++;
+			continue;
+		}
+
+		c = (unsigned char)(*src)[1];
+		*src += 2;
+		if (c == 'u') {
+			for (size_t i = 0; i < 4; i++) {
+				if (!strchr("0123456789abcdefABCDEF", *(*src)++)) {
+					return false;
+				}
+			}
+		} else if (!c || !strchr("\"\\/bfnrt", c)) {
+			return false;
+		}
+	}
+}
+
+static bool parse_list(const char **src, char close, bool members)
+{
+	(*src)++;
+	skip_space(src);
+	if (**src == close) {
+		(*src)++;
+		return true;
+	}
+	for (;;) {
+		skip_space(src);
+		if (members) {
+			if (!parse_string(src)) {
+				return false;
+			}
+			skip_space(src);
+			if (*(*src)++ != ':') {
+				return false;
+			}
+		}
+		if (!parse_value(src)) {
+			return false;
+		}
+		skip_space(src);
+		char c = *(*src)++;
+		if (c == close) {
+			return true;
+		} else if (c != ',') {
+			return false;
+		}
+	}
+}
+
+static bool parse_value(const char **src)
+{
+	skip_space(src);
+	switch (**src) {
+	case '{':
+		return parse_list(src, '}', true);
+	case '[':
+		return parse_list(src, ']', false);
+	case '"':
+		return parse_string(src);
+	default:
+		if (!strchr("-0123456789", **src)) {
+			return false;
+		}
+		while (strchr("-+.eE0123456789", **src) && **src) {
+			(*src)++;
+		}
+		return true;
+	}
+}
+
+static const bc_src_file *load_text(void)
+{
+	static const char text[] = "int a;\n";
+	char path[] = "/tmp/bc_error_\"\\\x01\xff_XXXXXX";
+	int fd = mkstemp(path);
+	TEST_ASSERT(fd >= 0);
+	TEST_ASSERT(write(fd, text, sizeof(text) - 1) == sizeof(text) - 1);
+	close(fd);
+
+	const bc_src_file *file = src_file_load(path);
+	unlink(path);
+	TEST_ASSERT(file);
+	return file;
+}
+
+static void emit(const bc_src_file *file)
+{
+	bc_ctx ctx;
+	ctx_init(&ctx, file, imm_str_read(src_file_text(file)) + 4, 1);
+	error_at(BC_ERROR_WARN, &ctx, "%s", g_message);
+	error_msg(BC_ERROR_NOTE, "%s without location", g_message);
+}
+
+static void check_escapes(const char *out)
+{
+	TEST_ASSERT(strstr(out, "quote \\\" slash \\\\ tab \\t nl \\n"));
+	TEST_ASSERT(strstr(out, "ctl \\u0001\\u001f"));
+	TEST_ASSERT(strstr(out, "ok \xc3\xa9 \xf0\x9f\x98\x80 bad \\ufffd"));
+	TEST_ASSERT(strstr(out, "trunc \\ufffd over \\ufffd\\ufffd"));
+	TEST_ASSERT(strstr(out, "sur \\ufffd\\ufffd\\ufffd end"));
+	TEST_ASSERT(strstr(out, "bc_error_\\\"\\\\\\u0001\\ufffd_"));
+}
+
+int main(void)
+{
+	const bc_src_file *file = load_text();
+	char out[OUTPUT_MAX];
+
+	/* Every JSON Lines record is one complete value */
+	error_set_output(BC_ERROR_OUTPUT_JSONL);
+	begin_capture();
+	emit(file);
+	end_capture(out);
+	check_escapes(out);
+
+	size_t records = 0;
+	for (const char *at = out; *at; records++) {
+		TEST_ASSERT(parse_value(&at));
+		TEST_ASSERT(*at++ == '\n');
+	}
+	TEST_ASSERT(records == 2);
+
+	/* The SARIF log is one document, closed when the output changes */
+	begin_capture();
+	error_set_output(BC_ERROR_OUTPUT_SARIF);
+	emit(file);
+	error_set_output(BC_ERROR_OUTPUT_TEXT);
+	end_capture(out);
+	check_escapes(out);
+
+	const char *at = out;
+	TEST_ASSERT(parse_value(&at));
+	skip_space(&at);
+	TEST_ASSERT(!*at);
+
+	rc_unref(file);
+	return EXIT_SUCCESS;
+}
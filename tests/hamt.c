@@ -0,0 +1,82 @@
+#include "hamt.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define KEY_COUNT 5000
+
+static char g_keys[KEY_COUNT][32];
+static size_t g_key_lens[KEY_COUNT];
+
+static size_t *create_value(size_t value)
+{
+	size_t *ptr = rc_alloc(sizeof(*ptr), NULL);
+	TEST_ASSERT(ptr);
+	*ptr = value;
+	return ptr;
+}
+
+static void check_value(const bc_hamt *hamt, size_t i, size_t value)
+{
+	const bc_hamt_entry *entry = hamt_find(hamt, g_keys[i], g_key_lens[i]);
+	TEST_ASSERT(entry);
+	TEST_ASSERT(*(const size_t *)hamt_entry_value(entry) == value);
+
+	const bc_imm_str *key = hamt_entry_key(entry);
+	TEST_ASSERT(imm_str_len(key) == g_key_lens[i]);
+	TEST_ASSERT(!memcmp(imm_str_read(key), g_keys[i], g_key_lens[i]));
+	TEST_ASSERT(hamt_find_str(hamt, key) == entry);
+}
+
+int main(void)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		g_key_lens[i] = (size_t)snprintf(
+			g_keys[i], sizeof(g_keys[i]), i % 2 ? "k%zu" : "long_name_%zu", i);
+	}
+
+	const bc_hamt *hamt = NULL;
+	TEST_ASSERT(!hamt_find(hamt, g_keys[0], g_key_lens[0]));
+	for (size_t i = 0; i < KEY_COUNT; i += 2) {
+		TEST_ASSERT(
+			hamt_define(&hamt, g_keys[i], g_key_lens[i], create_value(i)));
+	}
+
+	/* Older versions are unaffected by edits to newer ones */
+	const bc_hamt *old = rc_ref(hamt);
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		TEST_ASSERT(hamt_define(
+			&hamt, g_keys[i], g_key_lens[i], create_value(i + KEY_COUNT)));
+	}
+	for (size_t i = 0; i < KEY_COUNT; i += 3) {
+		hamt_delete(&hamt, g_keys[i], g_key_lens[i]);
+	}
+	hamt_delete(&hamt, "missing", 7);
+
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		if (i % 2 == 0) {
+			check_value(old, i, i);
+		} else {
+			TEST_ASSERT(!hamt_find(old, g_keys[i], g_key_lens[i]));
+		}
+
+		if (i % 3 == 0) {
+			TEST_ASSERT(!hamt_find(hamt, g_keys[i], g_key_lens[i]));
+		} else {
+			check_value(hamt, i, i + KEY_COUNT);
+		}
+	}
+	rc_unref(old);
+
+	/* Deleting every key collapses the trie back to empty */
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		hamt_delete(&hamt, g_keys[i], g_key_lens[i]);
+	}
+	TEST_ASSERT(!hamt);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+#include "hash.h"
+#include "imm_str.h"
+#include "rc.h"
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define ALIGN_MAX 32
+#define LEN_MAX 256
+
+static unsigned char g_buf[ALIGN_MAX + LEN_MAX];
+static uint64_t g_random = 9;
+
+static inline uint64_t next_random(void)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+	return g_random;
+}
+
+/* Every stripe kernel must give the scalar kernel's hash */
+static void check_impl(int impl)
+{
+	for (size_t align = 0; align < ALIGN_MAX; align++) {
+		for (size_t len = 0; len <= LEN_MAX; len++) {
+			TEST_ASSERT(hash_set_impl(BC_HASH_IMPL_SCALAR));
+			uint64_t expect = hash_bytes(g_buf + align, len);
+			TEST_ASSERT(hash_set_impl(impl));
+			TEST_ASSERT(hash_bytes(g_buf + align, len) == expect);
+		}
+	}
+}
+
+/* The hash cached in a string is the hash of its bytes */
+static void check_cached(void)
+{
+	for (size_t len = 0; len <= LEN_MAX; len++) {
+		const char *src = (const char *)g_buf + len % ALIGN_MAX;
+		uint64_t expect = hash_bytes(src, len);
+
+		const bc_imm_str *str = imm_str_create_n(src, len);
+		TEST_ASSERT(str);
+		TEST_ASSERT(imm_str_hash(str) == expect);
+		TEST_ASSERT(imm_str_hash(str) == expect);
+
+		const bc_imm_str *interned = imm_str_intern_n(src, len);
+		TEST_ASSERT(interned);
+		TEST_ASSERT(imm_str_hash(interned) == expect);
+		rc_unref(str);
+		rc_unref(interned);
+	}
+
+	BC_IMM_STR_DEFINE(literal, "static string literal");
+	TEST_ASSERT(
+		imm_str_hash(literal) ==
+		hash_bytes(imm_str_read(literal), imm_str_len(literal)));
+}
+
+int main(void)
+{
+	static const int impls[] = {
+		BC_HASH_IMPL_SCALAR,
+		BC_HASH_IMPL_SSE2,
+		BC_HASH_IMPL_AVX2,
+	};
+
+	for (size_t i = 0; i < sizeof(g_buf); i++) {
+		g_buf[i] = (unsigned char)next_random();
+	}
+
+	TEST_ASSERT(!hash_set_impl(-1));
+	for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+		if (hash_set_impl(impls[i])) {
+			check_impl(impls[i]);
+			check_cached();
+		}
+	}
+	return EXIT_SUCCESS;
+}
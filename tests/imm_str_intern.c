@@ -0,0 +1,64 @@
+#include "imm_str.h"
+#include "rc.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+
+/* Configuration Knobs */
+
+#define THREAD_COUNT 8
+#define KEY_COUNT 20000
+
+static char g_keys[KEY_COUNT][32];
+static size_t g_key_lens[KEY_COUNT];
+static const bc_imm_str *g_interned[THREAD_COUNT][KEY_COUNT];
+
+/* Each thread walks the keys from a different starting point, so threads
+ * race to insert the same bytes into the same shard */
+static int run_worker(void *arg)
+{
+	size_t id = (size_t)arg;
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		size_t key = (i + id * KEY_COUNT / THREAD_COUNT) % KEY_COUNT;
+		g_interned[id][key] = imm_str_intern_n(g_keys[key], g_key_lens[key]);
+	}
+	return 0;
+}
+
+int main(void)
+{
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		g_key_lens[i] = (size_t)snprintf(
+			g_keys[i], sizeof(g_keys[i]), "interned_key_%zu", i);
+	}
+
+	thrd_t threads[THREAD_COUNT];
+	for (size_t i = 0; i < THREAD_COUNT; i++) {
+		TEST_ASSERT(
+			thrd_create(&threads[i], run_worker, (void *)i) == thrd_success);
+	}
+	for (size_t i = 0; i < THREAD_COUNT; i++) {
+		TEST_ASSERT(thrd_join(threads[i], NULL) == thrd_success);
+	}
+
+	for (size_t i = 0; i < KEY_COUNT; i++) {
+		const bc_imm_str *str = g_interned[0][i];
+		TEST_ASSERT(str);
+		TEST_ASSERT(imm_str_len(str) == g_key_lens[i]);
+		TEST_ASSERT(!memcmp(imm_str_read(str), g_keys[i], g_key_lens[i]));
+		for (size_t id = 1; id < THREAD_COUNT; id++) {
+			TEST_ASSERT(g_interned[id][i] == str);
+		}
+		TEST_ASSERT(imm_str_intern(g_keys[i]) == str);
+		TEST_ASSERT(i == 0 || str != g_interned[0][i - 1]);
+	}
+
+	for (size_t id = 0; id < THREAD_COUNT; id++) {
+		for (size_t i = 0; i < KEY_COUNT; i++) {
+			rc_unref(g_interned[id][i]);
+		}
+	}
+	return EXIT_SUCCESS;
+}
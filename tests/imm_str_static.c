@@ -0,0 +1,45 @@
+#include "imm_str.h"
+#include "rc.h"
+#include "test.h"
+
+#include <string.h>
+
+static const bc_imm_str *g_file_str;
+
+static const bc_imm_str *get_block_str(void)
+{
+	BC_IMM_STR_DEFINE(str, "block scope");
+	return str;
+}
+
+/* Overwrite the stack where an automatic compound literal would live */
+static void clobber_stack(void)
+{
+	volatile char buf[256];
+	memset((char *)buf, '#', sizeof(buf));
+}
+
+int main(void)
+{
+	g_file_str = BC_IMM_STR_STATIC("file scope");
+	TEST_ASSERT(imm_str_len(g_file_str) == 10);
+	TEST_ASSERT(!strcmp(imm_str_read(g_file_str), "file scope"));
+
+	const bc_imm_str *str = get_block_str();
+	clobber_stack();
+	TEST_ASSERT(str == get_block_str());
+	TEST_ASSERT(imm_str_len(str) == 11);
+	TEST_ASSERT(!strcmp(imm_str_read(str), "block scope"));
+
+	const bc_imm_str *copy = imm_str_create("block scope");
+	TEST_ASSERT(copy);
+	TEST_ASSERT(imm_str_equal(str, copy));
+	TEST_ASSERT(imm_str_hash(str) == imm_str_hash(copy));
+	rc_unref(copy);
+
+	TEST_ASSERT(rc_ref(str) == str);
+	rc_unref(str);
+	rc_unref(str);
+	TEST_ASSERT(!strcmp(imm_str_read(str), "block scope"));
+	return EXIT_SUCCESS;
+}
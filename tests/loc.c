@@ -0,0 +1,120 @@
+#include "imm_str.h"
+#include "loc.h"
+#include "rc.h"
+#include "src_file.h"
+#include "test.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define FILE_COUNT 200
+
+static const bc_src_file *g_files[FILE_COUNT];
+static bc_loc g_firsts[FILE_COUNT];
+static atomic_size_t g_published;
+
+static const bc_src_file *load_file(size_t index)
+{
+	char text[128];
+	int len = snprintf(
+		text, sizeof(text), "int f%zu;\n\nint g%zu = %zu;\n", index, index,
+		index);
+
+	char path[] = "/tmp/bc_loc_XXXXXX";
+	int fd = mkstemp(path);
+	TEST_ASSERT(fd >= 0);
+	TEST_ASSERT(write(fd, text, (size_t)len) == len);
+	close(fd);
+
+	const bc_src_file *file = src_file_load(path);
+	unlink(path);
+	TEST_ASSERT(file);
+	return file;
+}
+
+static void check_round_trip(size_t index)
+{
+	const bc_src_file *file = g_files[index];
+	const bc_imm_str *text = src_file_text(file);
+	const char *start = imm_str_read(text);
+	size_t len = imm_str_len(text);
+
+	for (size_t offset = 0; offset <= len; offset++) {
+		bc_loc loc = loc_encode(file, start + offset);
+		TEST_ASSERT(loc != BC_LOC_NONE);
+		TEST_ASSERT(loc == g_firsts[index] + offset);
+		TEST_ASSERT(loc_file(loc) == file);
+		TEST_ASSERT(loc_at(loc) == start + offset);
+	}
+
+	/* "int f<i>;\n\nint g<i>" puts 'g' on line 3, column 5 */
+	size_t line, col;
+	const char *at = strchr(start, 'g');
+	TEST_ASSERT(loc_get_pos(&line, &col, loc_encode(file, at)));
+	TEST_ASSERT(line == 3 && col == 5);
+}
+
+/* Decodes run without the lock while other files are being registered */
+static int run_reader(void *arg)
+{
+	(void)arg;
+	size_t checked = 0;
+	while (checked < FILE_COUNT) {
+		size_t published =
+			atomic_load_explicit(&g_published, memory_order_acquire);
+		for (; checked < published; checked++) {
+			TEST_ASSERT(loc_file(g_firsts[checked]) == g_files[checked]);
+		}
+		thrd_yield();
+	}
+	return 0;
+}
+
+int main(void)
+{
+	TEST_ASSERT(!loc_file(BC_LOC_NONE));
+	TEST_ASSERT(!loc_at(BC_LOC_NONE));
+	size_t line, col;
+	TEST_ASSERT(!loc_get_pos(&line, &col, BC_LOC_NONE));
+
+	thrd_t reader;
+	TEST_ASSERT(thrd_create(&reader, run_reader, NULL) == thrd_success);
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		g_files[i] = load_file(i);
+		const char *start = imm_str_read(src_file_text(g_files[i]));
+		g_firsts[i] = loc_encode(g_files[i], start);
+		TEST_ASSERT(g_firsts[i] != BC_LOC_NONE);
+		TEST_ASSERT(!i || g_firsts[i] > g_firsts[i - 1]);
+		atomic_store_explicit(&g_published, i + 1, memory_order_release);
+	}
+	TEST_ASSERT(thrd_join(reader, NULL) == thrd_success);
+
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		check_round_trip(i);
+	}
+
+	/* Pointers outside the file's text do not encode */
+	const char *start = imm_str_read(src_file_text(g_files[0]));
+	size_t len = imm_str_len(src_file_text(g_files[0]));
+	TEST_ASSERT(loc_encode(g_files[0], start - 1) == BC_LOC_NONE);
+	TEST_ASSERT(loc_encode(g_files[0], start + len + 1) == BC_LOC_NONE);
+	TEST_ASSERT(
+		loc_encode(g_files[0], imm_str_read(src_file_text(g_files[1]))) ==
+		BC_LOC_NONE);
+
+	/* Past the end of the last file is not a location */
+	const bc_src_file *last = g_files[FILE_COUNT - 1];
+	bc_loc end = g_firsts[FILE_COUNT - 1] +
+				 (bc_loc)imm_str_len(src_file_text(last)) + 1;
+	TEST_ASSERT(!loc_file(end));
+
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		rc_unref(g_files[i]);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#include "rc.h"
+#include "test.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Configuration Knobs */
+
+#define OBJECT_COUNT 1000
+
+typedef struct test_object {
+	uint64_t value;
+} test_object;
+
+static atomic_size_t g_released;
+
+static void visit_object(const void *ptr, void (*fn)(const void *))
+{
+	(void)ptr;
+	if (fn == rc_unref) {
+		atomic_fetch_add(&g_released, 1);
+	}
+}
+
+static void churn_objects(void)
+{
+	for (size_t i = 0; i < OBJECT_COUNT; i++) {
+		test_object *object = rc_alloc(sizeof(*object), visit_object);
+		TEST_ASSERT(object);
+		object->value = i;
+		rc_unref(object);
+	}
+}
+
+int main(void)
+{
+	rc_defer(true);
+	churn_objects();
+	TEST_ASSERT(atomic_load(&g_released) == 0);
+
+	/* Turning deferral off must not strand the pending list */
+	rc_defer(false);
+	rc_collect();
+	TEST_ASSERT(atomic_load(&g_released) == OBJECT_COUNT);
+
+	TEST_ASSERT(rc_collector_start());
+	churn_objects();
+	rc_collector_stop();
+	TEST_ASSERT(atomic_load(&g_released) == 2 * OBJECT_COUNT);
+
+	rc_defer(true);
+	churn_objects();
+	rc_collector_stop();
+	TEST_ASSERT(atomic_load(&g_released) == 3 * OBJECT_COUNT);
+
+	rc_defer(false);
+	churn_objects();
+	TEST_ASSERT(atomic_load(&g_released) == 4 * OBJECT_COUNT);
+	return EXIT_SUCCESS;
+}
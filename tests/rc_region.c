@@ -0,0 +1,146 @@
+#include "rc.h"
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define FILLER_COUNT 5000
+#define LARGE_SIZE (256 << 10)
+
+typedef struct node {
+	const void *child;
+	uint32_t value;
+	char name[20];
+} node;
+
+static void visit_node(const void *ptr, void (*visitor)(const void *))
+{
+	const node *n = ptr;
+	visitor(n->child);
+}
+
+static const node *create_node(const void *child, uint32_t value)
+{
+	node *n = rc_alloc(sizeof(*n), visit_node);
+	TEST_ASSERT(n);
+	n->child = rc_ref(child);
+	n->value = value;
+	snprintf(n->name, sizeof(n->name), "node %u", value);
+	return n;
+}
+
+/* Fills region chunks around the object so popping has memory to reuse */
+static void alloc_fillers(const void *child)
+{
+	for (uint32_t i = 0; i < FILLER_COUNT; i++) {
+		create_node(child, i);
+		unsigned char *bytes = rc_alloc(i % 200, NULL);
+		TEST_ASSERT(bytes);
+		memset(bytes, 0xa5, i % 200);
+	}
+}
+
+static void check_node(const node *n, const void *child, uint32_t value)
+{
+	char name[20];
+	snprintf(name, sizeof(name), "node %u", value);
+	TEST_ASSERT(n->child == child);
+	TEST_ASSERT(n->value == value);
+	TEST_ASSERT(!strcmp(n->name, name));
+}
+
+static void test_promote(void)
+{
+	unsigned char *leaf = rc_alloc(32, NULL);
+	TEST_ASSERT(leaf);
+	memset(leaf, 0x5a, 32);
+
+	TEST_ASSERT(rc_region_push());
+	alloc_fillers(leaf);
+	const node *n = create_node(leaf, 7);
+	alloc_fillers(leaf);
+	TEST_ASSERT(!rc_unique(leaf));
+
+	const node *promoted = rc_promote(n);
+	TEST_ASSERT(promoted && promoted != n);
+	TEST_ASSERT(rc_promote(promoted) == promoted);
+	check_node(promoted, leaf, 7);
+
+	/* Popping drops every region ref to the leaf but not the promoted one */
+	rc_region_pop();
+	TEST_ASSERT(!rc_unique(leaf));
+	check_node(promoted, leaf, 7);
+	TEST_ASSERT(rc_size(promoted) == sizeof(node));
+
+	/* Heap allocations made afterwards must not overlap the promoted copy */
+	for (uint32_t i = 0; i < FILLER_COUNT; i++) {
+		unsigned char *bytes = rc_alloc(sizeof(node), NULL);
+		TEST_ASSERT(bytes);
+		memset(bytes, 0xff, sizeof(node));
+		rc_unref(bytes);
+	}
+	check_node(promoted, leaf, 7);
+
+	rc_unref(promoted);
+	TEST_ASSERT(rc_unique(leaf));
+	for (size_t i = 0; i < 32; i++) {
+		TEST_ASSERT(leaf[i] == 0x5a);
+	}
+	rc_unref(leaf);
+}
+
+static void test_promote_large(void)
+{
+	TEST_ASSERT(rc_region_push());
+	unsigned char *large = rc_alloc(LARGE_SIZE, NULL);
+	TEST_ASSERT(large);
+	for (size_t i = 0; i < LARGE_SIZE; i++) {
+		large[i] = (unsigned char)(i * 31);
+	}
+
+	const unsigned char *promoted = rc_promote(large);
+	rc_region_pop();
+
+	TEST_ASSERT(rc_size(promoted) == LARGE_SIZE);
+	for (size_t i = 0; i < LARGE_SIZE; i++) {
+		TEST_ASSERT(promoted[i] == (unsigned char)(i * 31));
+	}
+	rc_unref(promoted);
+}
+
+/* A promotion from an inner region outlives both regions */
+static void test_promote_nested(void)
+{
+	unsigned char *leaf = rc_alloc(8, NULL);
+	TEST_ASSERT(leaf);
+
+	TEST_ASSERT(rc_region_push());
+	alloc_fillers(leaf);
+	TEST_ASSERT(rc_region_push());
+	const node *n = create_node(leaf, 42);
+	const node *promoted = rc_promote(n);
+	rc_region_pop();
+	check_node(promoted, leaf, 42);
+	alloc_fillers(leaf);
+	rc_region_pop();
+
+	check_node(promoted, leaf, 42);
+	rc_unref(promoted);
+	TEST_ASSERT(rc_unique(leaf));
+	rc_unref(leaf);
+}
+
+int main(void)
+{
+	test_promote();
+	test_promote_large();
+	test_promote_nested();
+
+	unsigned char *heap = rc_alloc(16, NULL);
+	TEST_ASSERT(rc_promote(heap) == heap);
+	TEST_ASSERT(rc_promote(NULL) == NULL);
+	rc_unref(heap);
+	return EXIT_SUCCESS;
+}
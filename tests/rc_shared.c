@@ -0,0 +1,120 @@
+#include "rc.h"
+#include "test.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <threads.h>
+
+/* Configuration Knobs */
+
+#define THREAD_COUNT 4
+#define OBJECT_COUNT 2000
+#define ROUND_COUNT 100
+#define MAGIC_LIVE UINT64_C(0x6c697665)
+#define MAGIC_DEAD UINT64_C(0x64656164)
+
+typedef struct test_object {
+	_Atomic uint64_t magic;
+} test_object;
+
+typedef struct test_barrier {
+	mtx_t mtx;
+	cnd_t cnd;
+	unsigned waiting;
+	unsigned round;
+} test_barrier;
+
+static const test_object *g_objects[THREAD_COUNT][OBJECT_COUNT];
+static atomic_size_t g_allocated;
+static atomic_size_t g_released;
+static test_barrier g_barrier;
+
+static void visit_object(const void *ptr, void (*fn)(const void *))
+{
+	if (fn != rc_unref) {
+		return;
+	}
+
+	test_object *object = (test_object *)ptr;
+	uint64_t magic = atomic_exchange(&object->magic, MAGIC_DEAD);
+	TEST_ASSERT(magic == MAGIC_LIVE);
+	atomic_fetch_add(&g_released, 1);
+}
+
+static void wait_barrier(test_barrier *barrier)
+{
+	mtx_lock(&barrier->mtx);
+	unsigned round = barrier->round;
+	if (++barrier->waiting == THREAD_COUNT) {
+		barrier->waiting = 0;
+		barrier->round++;
+		cnd_broadcast(&barrier->cnd);
+	} else {
+		while (round == barrier->round) {
+			cnd_wait(&barrier->cnd, &barrier->mtx);
+		}
+	}
+	mtx_unlock(&barrier->mtx);
+}
+
+static inline unsigned next_random(unsigned *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return *state >> 16;
+}
+
+static void check_live(const test_object *object)
+{
+	TEST_ASSERT(atomic_load(&object->magic) == MAGIC_LIVE);
+}
+
+static int run_worker(void *arg)
+{
+	size_t id = (size_t)arg;
+	unsigned state = (unsigned)id + 1;
+	for (size_t round = 0; round < ROUND_COUNT; round++) {
+		for (size_t i = 0; i < OBJECT_COUNT; i++) {
+			test_object *object = rc_alloc(sizeof(*object), visit_object);
+			TEST_ASSERT(object);
+			atomic_init(&object->magic, MAGIC_LIVE);
+			for (size_t j = 1; j < THREAD_COUNT; j++) {
+				rc_ref(object);
+			}
+			g_objects[id][i] = object;
+		}
+		atomic_fetch_add(&g_allocated, OBJECT_COUNT);
+		wait_barrier(&g_barrier);
+
+		for (size_t i = 0; i < THREAD_COUNT * OBJECT_COUNT; i++) {
+			size_t owner = (id + i) % THREAD_COUNT;
+			const test_object *object = g_objects[owner][i / THREAD_COUNT];
+			check_live(object);
+			if (next_random(&state) % 2) {
+				rc_ref(object);
+				check_live(object);
+				rc_unref(object);
+			}
+			rc_unref(object);
+		}
+		wait_barrier(&g_barrier);
+	}
+	return 0;
+}
+
+int main(void)
+{
+	mtx_init(&g_barrier.mtx, mtx_plain);
+	cnd_init(&g_barrier.cnd);
+
+	thrd_t threads[THREAD_COUNT];
+	for (size_t i = 0; i < THREAD_COUNT; i++) {
+		TEST_ASSERT(
+			thrd_create(&threads[i], run_worker, (void *)i) == thrd_success);
+	}
+	for (size_t i = 0; i < THREAD_COUNT; i++) {
+		thrd_join(threads[i], NULL);
+	}
+
+	TEST_ASSERT(atomic_load(&g_released) == atomic_load(&g_allocated));
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+#include "rc.h"
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define SIZE_MAX_TESTED 1100
+
+static void check_bytes(const unsigned char *data, size_t len, int value)
+{
+	for (size_t i = 0; i < len; i++) {
+		TEST_ASSERT(data[i] == value);
+	}
+}
+
+int main(void)
+{
+	for (size_t size = 0; size <= SIZE_MAX_TESTED; size++) {
+		unsigned char *data = rc_alloc(size, NULL);
+		TEST_ASSERT(data);
+		TEST_ASSERT(rc_size(data) == size);
+		memset(data, 0xa5, size);
+
+		/* Shrinking within a size class must not report stale capacity */
+		size_t shrunk = size / 2;
+		data = rc_resize(data, shrunk);
+		TEST_ASSERT(data);
+		TEST_ASSERT(rc_size(data) == shrunk);
+		check_bytes(data, shrunk, 0xa5);
+
+		/* Growing again must zero everything past the shrunk size */
+		data = rc_resize(data, size + 1);
+		TEST_ASSERT(data);
+		TEST_ASSERT(rc_size(data) == size + 1);
+		check_bytes(data, shrunk, 0xa5);
+		check_bytes(data + shrunk, size + 1 - shrunk, 0);
+
+		const void *copy = rc_ref(data);
+		unsigned char *edit = rc_edit(copy);
+		TEST_ASSERT(edit != data);
+		TEST_ASSERT(rc_size(edit) == size + 1);
+		rc_unref(edit);
+		rc_unref(data);
+	}
+
+	TEST_ASSERT(rc_size(NULL) == 0);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+#include "imm_str.h"
+#include "rc.h"
+#include "rope.h"
+#include "test.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define PIECE_COUNT 200
+#define WIDE_PIECE_COUNT 1000
+#define WIDE_PIECE_LEN 100
+
+static const char g_text[] = "the quick brown fox jumps over the lazy dog, "
+							 "pack my box with five dozen liquor jugs";
+
+static void check_rope(const bc_rope *rope, const char *expect, size_t len)
+{
+	TEST_ASSERT(rope_len(rope) == len);
+	for (size_t i = 0; i < len; i++) {
+		TEST_ASSERT(rope_index(rope, i) == expect[i]);
+	}
+	TEST_ASSERT(rope_index(rope, len) == '\0');
+	TEST_ASSERT(rope_index(rope, SIZE_MAX) == '\0');
+
+	const bc_imm_str *flat = rope_flatten(rope);
+	TEST_ASSERT(flat);
+	TEST_ASSERT(imm_str_len(flat) == len);
+	TEST_ASSERT(!memcmp(imm_str_read(flat), expect, len));
+	rc_unref(flat);
+
+	FILE *f = tmpfile();
+	TEST_ASSERT(f);
+	TEST_ASSERT(rope_write(rope, f));
+	rewind(f);
+	for (size_t i = 0; i < len; i++) {
+		TEST_ASSERT(fgetc(f) == (unsigned char)expect[i]);
+	}
+	TEST_ASSERT(fgetc(f) == EOF);
+	fclose(f);
+}
+
+/* Small slices keep their bytes inline, so the rope must copy them */
+static const bc_rope *rope_from_small(const char *at, size_t len)
+{
+	bc_imm_str_slice slice;
+	const bc_imm_str *str = imm_str_create_n(at, len);
+	TEST_ASSERT(str);
+	imm_str_slice_init(&slice, str, imm_str_read(str), len);
+
+	const bc_rope *rope = rope_from_str_slice(&slice);
+	memset(slice.small, '#', sizeof(slice.small));
+	imm_str_slice_clear(&slice);
+	return rope;
+}
+
+static void test_small_slices(void)
+{
+	size_t len = sizeof(g_text) - 1;
+	const bc_rope *rope = NULL;
+	for (size_t at = 0; at < len;) {
+		size_t piece = 1 + at % BC_IMM_STR_SLICE_SMALL_MAX;
+		if (piece > len - at) {
+			piece = len - at;
+		}
+		rope = rope_concat(rope, rope_from_small(g_text + at, piece));
+		at += piece;
+	}
+	check_rope(rope, g_text, len);
+
+	const bc_rope *single = rope_from_small(g_text, 3);
+	check_rope(single, g_text, 3);
+	rc_unref(single);
+
+	const bc_rope *sub = rope_substr(rope, 4, 15);
+	check_rope(sub, g_text + 4, 15);
+	rc_unref(sub);
+	rc_unref(rope);
+}
+
+static void test_borrowed(void)
+{
+	char buf[sizeof(g_text)];
+	memcpy(buf, g_text, sizeof(buf));
+	const bc_rope *rope = rope_from_slice(NULL, buf, sizeof(buf) - 1);
+	memset(buf, '#', sizeof(buf));
+	check_rope(rope, g_text, sizeof(g_text) - 1);
+	rc_unref(rope);
+}
+
+static void test_pieces(void)
+{
+	const bc_imm_str *str = imm_str_create(g_text);
+	TEST_ASSERT(str);
+	size_t len = imm_str_len(str);
+
+	char expect[PIECE_COUNT * sizeof(g_text)];
+	size_t expect_len = 0;
+	const bc_rope *rope = NULL;
+	for (size_t i = 0; i < PIECE_COUNT; i++) {
+		size_t start = i * 7 % len;
+		size_t piece = 1 + i * 13 % (len - start);
+		const bc_rope *leaf = rope_from_slice(
+			rc_ref(str), imm_str_read(str) + start, piece);
+		if (i % 3) {
+			rope = rope_concat(rope, leaf);
+			memcpy(expect + expect_len, g_text + start, piece);
+		} else {
+			rope = rope_concat(leaf, rope);
+			memmove(expect + piece, expect, expect_len);
+			memcpy(expect, g_text + start, piece);
+		}
+		expect_len += piece;
+	}
+	check_rope(rope, expect, expect_len);
+
+	for (size_t start = 0; start < expect_len; start += 97) {
+		const bc_rope *sub = rope_substr(rope, start, 301);
+		size_t sub_len = expect_len - start < 301 ? expect_len - start : 301;
+		check_rope(sub, expect + start, sub_len);
+		rc_unref(sub);
+	}
+
+	const bc_rope *whole = rope_from_str(rc_ref(str));
+	const bc_imm_str *flat = rope_flatten(whole);
+	TEST_ASSERT(flat == str);
+	rc_unref(flat);
+	rc_unref(whole);
+	rc_unref(rope);
+	rc_unref(str);
+}
+
+/* Leaves too long to merge, so writes span many writev batches */
+static void test_wide(void)
+{
+	static char expect[WIDE_PIECE_COUNT * WIDE_PIECE_LEN];
+	for (size_t i = 0; i < sizeof(expect); i++) {
+		expect[i] = (char)('a' + i % 26 + i / WIDE_PIECE_LEN % 2);
+	}
+
+	const bc_rope *rope = NULL;
+	for (size_t i = 0; i < WIDE_PIECE_COUNT; i++) {
+		const bc_imm_str *str =
+			imm_str_create_n(expect + i * WIDE_PIECE_LEN, WIDE_PIECE_LEN);
+		TEST_ASSERT(str);
+		rope = rope_concat(rope, rope_from_str(str));
+		TEST_ASSERT(rope);
+	}
+	check_rope(rope, expect, sizeof(expect));
+
+	const bc_rope *sub = rope_substr(rope, 150, 5000);
+	check_rope(sub, expect + 150, 5000);
+	TEST_ASSERT(!rope_substr(rope, sizeof(expect), 1));
+	rc_unref(sub);
+	rc_unref(rope);
+}
+
+int main(void)
+{
+	TEST_ASSERT(rope_len(NULL) == 0);
+	TEST_ASSERT(rope_index(NULL, 0) == '\0');
+	test_small_slices();
+	test_borrowed();
+	test_pieces();
+	test_wide();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+#include "scan.h"
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define ALIGN_MAX 32
+#define TAIL_MAX 64
+#define LEN_MAX 320
+
+typedef struct scan_result {
+	const char *find_one;
+	const char *find_few;
+	const char *find_full;
+	const char *skip;
+	size_t count;
+	size_t index_len;
+	size_t index[LEN_MAX];
+} scan_result;
+
+static const char g_set_full[BC_SCAN_SET_MAX] = "{}()[];,\n\"'\\/*\xe9\x80";
+static const char g_bytes[] = "abcXYZ_019 \t\n;{}\xe9\x80\xff\"/";
+static char g_buf[ALIGN_MAX + LEN_MAX];
+static uint64_t g_random = 5;
+
+static inline size_t next_random(size_t bound)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+	return (size_t)(g_random % bound);
+}
+
+static void run_scan(scan_result *dest, const char *at, size_t len)
+{
+	const char *end = at + len;
+	dest->find_one = scan_find_any(at, end, "\n", 1);
+	dest->find_few = scan_find_any(at, end, ";{\xe9", 3);
+	dest->find_full = scan_find_any(at, end, g_set_full, BC_SCAN_SET_MAX);
+	dest->skip = scan_skip_ident(at, end);
+	dest->count = scan_count_newlines(at, end);
+	dest->index_len = scan_index_newlines(at, end, dest->index);
+}
+
+/* Every kernel set must agree with the scalar kernels */
+static void check_impl(int impl, const char *at, size_t len)
+{
+	static scan_result expect, actual;
+	TEST_ASSERT(scan_set_impl(BC_SCAN_IMPL_SCALAR));
+	run_scan(&expect, at, len);
+	TEST_ASSERT(scan_set_impl(impl));
+	run_scan(&actual, at, len);
+
+	TEST_ASSERT(actual.find_one == expect.find_one);
+	TEST_ASSERT(actual.find_few == expect.find_few);
+	TEST_ASSERT(actual.find_full == expect.find_full);
+	TEST_ASSERT(actual.skip == expect.skip);
+	TEST_ASSERT(actual.count == expect.count);
+	TEST_ASSERT(actual.index_len == expect.index_len);
+	TEST_ASSERT(!memcmp(
+		actual.index, expect.index,
+		expect.index_len * sizeof(*expect.index)));
+}
+
+static void check_random(int impl)
+{
+	for (size_t align = 0; align < ALIGN_MAX; align++) {
+		for (size_t len = 0; len + align <= sizeof(g_buf); len++) {
+			if (len >= TAIL_MAX && len % 7) {
+				continue;
+			}
+			for (size_t i = 0; i < len; i++) {
+				g_buf[align + i] = g_bytes[next_random(sizeof(g_bytes) - 1)];
+			}
+			check_impl(impl, g_buf + align, len);
+		}
+	}
+}
+
+/* A single stop byte at every offset of an identifier run */
+static void check_needles(int impl, char needle)
+{
+	for (size_t align = 0; align < ALIGN_MAX; align += 3) {
+		char *at = g_buf + align;
+		for (size_t len = 0; len <= TAIL_MAX; len++) {
+			memset(at, 'a', len);
+			check_impl(impl, at, len);
+			for (size_t pos = 0; pos < len; pos++) {
+				at[pos] = needle;
+				check_impl(impl, at, len);
+				at[pos] = 'a';
+			}
+		}
+
+		size_t len = LEN_MAX - ALIGN_MAX;
+		memset(at, 'a', len);
+		for (size_t pos = 0; pos < len; pos++) {
+			at[pos] = needle;
+			check_impl(impl, at, len);
+			at[pos] = 'a';
+		}
+	}
+}
+
+int main(void)
+{
+	static const int impls[] = {
+		BC_SCAN_IMPL_SCALAR,
+		BC_SCAN_IMPL_SSE2,
+		BC_SCAN_IMPL_AVX2,
+	};
+
+	TEST_ASSERT(!scan_set_impl(-1));
+	for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+		if (!scan_set_impl(impls[i])) {
+			continue;
+		}
+		check_random(impls[i]);
+		check_needles(impls[i], '\n');
+		check_needles(impls[i], ';');
+		check_needles(impls[i], '\xe9');
+		check_needles(impls[i], ' ');
+	}
+	return EXIT_SUCCESS;
+}
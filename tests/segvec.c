@@ -0,0 +1,155 @@
+#include "segvec.h"
+#include "test.h"
+
+#include <stdint.h>
+
+/* Configuration Knobs */
+
+#define ITER_COUNT 100000
+#define OWNER_COUNT 16
+#define SRC_MAX 64
+#define TRUNC_MAX 100
+
+typedef struct {
+	int *count;
+	size_t value;
+} owned;
+
+static inline void owned_up(owned *unit)
+{
+	(*unit->count)++;
+}
+
+static inline void owned_down(owned *unit)
+{
+	TEST_ASSERT(--*unit->count >= 0);
+}
+
+BC_SEGVEC_IMPLEMENT_W_UTOR(owned_vec, owned, owned_up, owned_down)
+
+static int g_counts[OWNER_COUNT];
+static uint64_t g_random = 3;
+
+static inline size_t next_random(size_t bound)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+	return (size_t)(g_random % bound);
+}
+
+int main(void)
+{
+	owned_vec *vec = owned_vec_create();
+	TEST_ASSERT(vec);
+	size_t *model = malloc(ITER_COUNT * SRC_MAX * sizeof(*model));
+	TEST_ASSERT(model);
+	size_t model_len = 0;
+	owned *first = NULL;
+
+	for (size_t i = 0; i < ITER_COUNT; i++) {
+		size_t op = next_random(10);
+		if (op < 6) {
+			owned src[SRC_MAX];
+			size_t len = next_random(SRC_MAX);
+			for (size_t k = 0; k < len; k++) {
+				src[k].count = &g_counts[k % OWNER_COUNT];
+				src[k].value = next_random(SIZE_MAX);
+				model[model_len + k] = src[k].value;
+			}
+			TEST_ASSERT(!owned_vec_append(vec, src, len));
+			model_len += len;
+		} else if (op < 8) {
+			/* Pushing transfers an already held count */
+			owned unit = {&g_counts[3], next_random(SIZE_MAX)};
+			owned_up(&unit);
+			TEST_ASSERT(!owned_vec_push(vec, unit));
+			model[model_len++] = unit.value;
+		} else if (op == 8 && model_len) {
+			size_t len = next_random(
+				model_len < TRUNC_MAX ? model_len + 1 : TRUNC_MAX);
+			TEST_ASSERT(!owned_vec_trunc(vec, len));
+			model_len -= len;
+			if (!next_random(4)) {
+				TEST_ASSERT(!owned_vec_shrink(vec));
+				first = model_len ? first : NULL;
+			}
+		} else if (model_len && next_random(2)) {
+			owned unit = owned_vec_pop_unsafe(vec);
+			TEST_ASSERT(unit.value == model[--model_len]);
+			owned_down(&unit);
+		} else if (model_len) {
+			/* Popping hands the counts over, possibly across chunks */
+			owned popped[SRC_MAX];
+			size_t len = next_random(
+				(model_len < SRC_MAX ? model_len : SRC_MAX - 1) + 1);
+			TEST_ASSERT(!owned_vec_pop_n(popped, vec, len));
+			model_len -= len;
+			for (size_t k = 0; k < len; k++) {
+				TEST_ASSERT(popped[k].value == model[model_len + k]);
+				owned_down(&popped[k]);
+			}
+		}
+
+		/* Growth never moves existing elements */
+		if (model_len && !first) {
+			first = owned_vec_at(vec, 0);
+		}
+		TEST_ASSERT(!model_len || owned_vec_at(vec, 0) == first);
+	}
+
+	TEST_ASSERT(vec->len == model_len);
+	for (size_t i = 0; i < model_len; i++) {
+		TEST_ASSERT(owned_vec_at(vec, i)->value == model[i]);
+	}
+
+	/* Indexes at or past the end are rejected, even on a chunk boundary
+	 * where the next chunk is not allocated */
+	size_t len;
+	TEST_ASSERT(!owned_vec_at(vec, vec->len));
+	TEST_ASSERT(!owned_vec_span(vec, vec->len, &len) && !len);
+	TEST_ASSERT(!owned_vec_span(vec, SIZE_MAX, &len) && !len);
+	TEST_ASSERT(owned_vec_pop_n(NULL, vec, vec->len + 1) ==
+				BC_SEGVEC_E_UNDERFLOW);
+
+	owned_vec *edge = owned_vec_create();
+	TEST_ASSERT(edge);
+	for (size_t i = 0; i < BC_SEGVEC_FIRST_CAP; i++) {
+		owned unit = {&g_counts[0], i};
+		owned_up(&unit);
+		TEST_ASSERT(!owned_vec_push(edge, unit));
+	}
+	TEST_ASSERT(edge->chunks == 1);
+	TEST_ASSERT(!owned_vec_at(edge, BC_SEGVEC_FIRST_CAP));
+	TEST_ASSERT(!owned_vec_span(edge, BC_SEGVEC_FIRST_CAP, &len) && !len);
+	owned_vec_destroy(edge);
+
+	/* Spans cover the vector in order and stop at chunk boundaries */
+	size_t span_count = 0;
+	for (size_t i = 0; i < vec->len;) {
+		size_t len;
+		owned *span = owned_vec_span(vec, i, &len);
+		TEST_ASSERT(len && len <= vec->len - i);
+		for (size_t k = 0; k < len; k++) {
+			TEST_ASSERT(span[k].value == model[i + k]);
+		}
+		i += len;
+		span_count++;
+	}
+	TEST_ASSERT(span_count <= vec->chunks);
+
+	int expect[OWNER_COUNT] = {0};
+	for (size_t i = 0; i < vec->len; i++) {
+		expect[owned_vec_at(vec, i)->count - g_counts]++;
+	}
+	for (size_t i = 0; i < OWNER_COUNT; i++) {
+		TEST_ASSERT(expect[i] == g_counts[i]);
+	}
+
+	owned_vec_destroy(vec);
+	for (size_t i = 0; i < OWNER_COUNT; i++) {
+		TEST_ASSERT(!g_counts[i]);
+	}
+	free(model);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+#include "test.h"
+#include "vec.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* Configuration Knobs */
+
+#define INLINE_CAP 4
+#define ITER_COUNT 200000
+#define LEN_MAX 1000
+#define SRC_MAX 20
+
+BC_SMALLVEC_IMPLEMENT(int_vec, int, INLINE_CAP)
+
+static int g_model[LEN_MAX + 2 * SRC_MAX];
+static size_t g_model_len;
+static uint64_t g_random = 1;
+
+static inline size_t next_random(size_t bound)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+	return (size_t)(g_random % bound);
+}
+
+static void model_splice(size_t index, size_t delete_len, const int *src,
+						 size_t insert_len)
+{
+	memmove(g_model + index + insert_len, g_model + index + delete_len,
+			(g_model_len - index - delete_len) * sizeof(*g_model));
+	memcpy(g_model + index, src, insert_len * sizeof(*g_model));
+	g_model_len += insert_len - delete_len;
+}
+
+static void check_model(int_vec *vec)
+{
+	TEST_ASSERT(vec->len == g_model_len);
+	TEST_ASSERT(vec->cap >= INLINE_CAP);
+	TEST_ASSERT(
+		!memcmp(int_vec_elem(vec), g_model, g_model_len * sizeof(*g_model)));
+}
+
+int main(void)
+{
+	int_vec vec;
+	int_vec_init(&vec);
+
+	for (size_t i = 0; i < ITER_COUNT; i++) {
+		if (g_model_len > LEN_MAX) {
+			TEST_ASSERT(!int_vec_trunc(&vec, SRC_MAX));
+			g_model_len -= SRC_MAX;
+		}
+
+		int src[SRC_MAX];
+		size_t len = next_random(g_model_len < 2 * INLINE_CAP ? 6 : SRC_MAX);
+		for (size_t k = 0; k < len; k++) {
+			src[k] = (int)next_random(INT32_MAX);
+		}
+
+		/* Sources pointing into the vector itself must survive a regrow */
+		const int *from = src;
+		if (g_model_len && next_random(2)) {
+			size_t start = next_random(g_model_len);
+			if (len > g_model_len - start) {
+				len = g_model_len - start;
+			}
+			from = int_vec_elem(&vec) + start;
+			memcpy(src, from, len * sizeof(*src));
+		}
+
+		size_t index = next_random(g_model_len + 1);
+		size_t tail = g_model_len - index;
+		switch (next_random(8)) {
+		case 0:
+			TEST_ASSERT(!int_vec_push(&vec, src[0]));
+			g_model[g_model_len++] = src[0];
+			break;
+		case 1:
+			TEST_ASSERT(!int_vec_insert(&vec, index, from, len));
+			model_splice(index, 0, src, len);
+			break;
+		case 2:
+			len = len < tail ? len : tail;
+			TEST_ASSERT(!int_vec_delete(&vec, index, len));
+			model_splice(index, len, src, 0);
+			break;
+		case 3: {
+			size_t delete_len = next_random(tail + 1);
+			TEST_ASSERT(!int_vec_splice(&vec, index, delete_len, from, len));
+			model_splice(index, delete_len, src, len);
+			break;
+		}
+		case 4:
+			len = len < tail ? len : tail;
+			TEST_ASSERT(!int_vec_overwrite(&vec, index, from, len));
+			model_splice(index, len, src, len);
+			break;
+		case 5:
+			TEST_ASSERT(!int_vec_append(&vec, from, len));
+			model_splice(g_model_len, 0, src, len);
+			break;
+		case 6:
+			if (g_model_len) {
+				TEST_ASSERT(int_vec_pop_unsafe(&vec) == g_model[--g_model_len]);
+			}
+			break;
+		default:
+			TEST_ASSERT(!int_vec_shrink(&vec));
+			break;
+		}
+		check_model(&vec);
+	}
+
+	/* Shrinking a short vector moves it back inline */
+	TEST_ASSERT(!int_vec_push(&vec, 7));
+	g_model[g_model_len++] = 7;
+	TEST_ASSERT(!int_vec_trunc(&vec, vec.len - 1));
+	TEST_ASSERT(!int_vec_shrink(&vec));
+	TEST_ASSERT(vec.len == 1 && vec.cap == INLINE_CAP);
+	TEST_ASSERT(*int_vec_elem(&vec) == g_model[0]);
+
+	int_vec_destroy(&vec);
+	TEST_ASSERT(vec.len == 0 && vec.cap == INLINE_CAP);
+	return EXIT_SUCCESS;
+}
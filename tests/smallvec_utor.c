@@ -0,0 +1,106 @@
+#include "test.h"
+#include "vec.h"
+
+#include <stdint.h>
+
+/* Configuration Knobs */
+
+#define INLINE_CAP 3
+#define ITER_COUNT 100000
+#define LEN_MAX 60
+#define OWNER_COUNT 32
+#define SRC_MAX 7
+
+typedef struct {
+	int *count;
+} owned;
+
+static inline void owned_up(owned *unit)
+{
+	(*unit->count)++;
+}
+
+static inline void owned_down(owned *unit)
+{
+	TEST_ASSERT(--*unit->count >= 0);
+}
+
+BC_SMALLVEC_IMPLEMENT_W_UTOR(owned_vec, owned, INLINE_CAP, owned_up, owned_down)
+
+static int g_counts[OWNER_COUNT];
+static uint64_t g_random = 2;
+
+static inline size_t next_random(size_t bound)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+	return (size_t)(g_random % bound);
+}
+
+/* Every live element holds exactly one count on its owner */
+static void check_counts(owned_vec *vec)
+{
+	int expect[OWNER_COUNT] = {0};
+	owned *elem = owned_vec_elem(vec);
+	for (size_t i = 0; i < vec->len; i++) {
+		expect[elem[i].count - g_counts]++;
+	}
+	for (size_t i = 0; i < OWNER_COUNT; i++) {
+		TEST_ASSERT(expect[i] == g_counts[i]);
+	}
+}
+
+int main(void)
+{
+	owned_vec vec;
+	owned_vec_init(&vec);
+
+	for (size_t i = 0; i < ITER_COUNT; i++) {
+		owned src[SRC_MAX];
+		size_t len = next_random(SRC_MAX);
+		for (size_t k = 0; k < len; k++) {
+			src[k].count = &g_counts[next_random(OWNER_COUNT)];
+		}
+
+		const owned *from = src;
+		if (vec.len && next_random(2)) {
+			size_t start = next_random(vec.len);
+			if (len > vec.len - start) {
+				len = vec.len - start;
+			}
+			from = owned_vec_elem(&vec) + start;
+		}
+
+		size_t index = next_random(vec.len + 1);
+		size_t tail = vec.len - index;
+		switch (next_random(5)) {
+		case 0:
+			TEST_ASSERT(!owned_vec_insert(&vec, index, from, len));
+			break;
+		case 1:
+			TEST_ASSERT(!owned_vec_splice(
+				&vec, index, next_random(tail + 1), from, len));
+			break;
+		case 2:
+			len = len < tail ? len : tail;
+			TEST_ASSERT(!owned_vec_overwrite(&vec, index, from, len));
+			break;
+		case 3:
+			len = len < tail ? len : tail;
+			TEST_ASSERT(!owned_vec_delete(&vec, index, len));
+			break;
+		default:
+			TEST_ASSERT(!owned_vec_append(&vec, from, len));
+			break;
+		}
+		if (vec.len > LEN_MAX) {
+			TEST_ASSERT(!owned_vec_trunc(&vec, LEN_MAX / 2));
+		}
+		check_counts(&vec);
+	}
+
+	owned_vec_destroy(&vec);
+	check_counts(&vec);
+	return EXIT_SUCCESS;
+}
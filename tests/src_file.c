@@ -0,0 +1,69 @@
+#include "imm_str.h"
+#include "rc.h"
+#include "src_file.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define LINE_COUNT_MAX 40
+
+static const bc_src_file *load_text(const char *text, size_t len)
+{
+	char path[] = "/tmp/bc_src_file_XXXXXX";
+	int fd = mkstemp(path);
+	TEST_ASSERT(fd >= 0);
+	TEST_ASSERT(write(fd, text, len) == (ssize_t)len);
+	close(fd);
+
+	const bc_src_file *file = src_file_load(path);
+	unlink(path);
+	TEST_ASSERT(file);
+	return file;
+}
+
+/* Line i holds i bytes of 'x', so every count hits a different size class */
+static void check_lines(size_t line_count)
+{
+	char text[LINE_COUNT_MAX * LINE_COUNT_MAX];
+	size_t len = 0;
+	for (size_t line = 0; line < line_count; line++) {
+		memset(text + len, 'x', line);
+		len += line;
+		if (line + 1 < line_count) {
+			text[len++] = '\n';
+		}
+	}
+
+	const bc_src_file *file = load_text(text, len);
+	TEST_ASSERT(src_file_line_count(file) == line_count);
+
+	const char *at = imm_str_read(src_file_text(file));
+	size_t offset = 0;
+	for (size_t line = 0; line < line_count; line++) {
+		for (size_t col = 0; col <= line && offset < len; col++) {
+			size_t line_pos, col_pos;
+			TEST_ASSERT(
+				src_file_get_pos(&line_pos, &col_pos, file, at + offset));
+			TEST_ASSERT(line_pos == line + 1);
+			TEST_ASSERT(col_pos == col + 1);
+			offset++;
+		}
+	}
+
+	size_t line_pos, col_pos;
+	TEST_ASSERT(src_file_get_pos(&line_pos, &col_pos, file, at + len));
+	TEST_ASSERT(line_pos == line_count);
+	rc_unref(file);
+}
+
+int main(void)
+{
+	for (size_t count = 1; count <= LINE_COUNT_MAX; count++) {
+		check_lines(count);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include "imm_str.h"
+#include "loc.h"
+#include "rc.h"
+#include "src_file.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define FILE_COUNT 5
+#define CACHE_MAX 4
+
+static char g_dir[] = "/tmp/bc_src_file_cache_XXXXXX";
+static char g_paths[FILE_COUNT][64];
+
+static void write_text(const char *path, const char *text)
+{
+	FILE *f = fopen(path, "w");
+	TEST_ASSERT(f);
+	TEST_ASSERT(fputs(text, f) >= 0);
+	TEST_ASSERT(!fclose(f));
+}
+
+static const bc_src_file *load(size_t index)
+{
+	const bc_src_file *file = src_file_load(g_paths[index]);
+	TEST_ASSERT(file);
+	return file;
+}
+
+int main(void)
+{
+	TEST_ASSERT(mkdtemp(g_dir));
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		snprintf(g_paths[i], sizeof(g_paths[i]), "%s/f%zu.c", g_dir, i);
+		write_text(g_paths[i], "int a;\n");
+	}
+
+	/* Loading the same file twice is a cache hit */
+	const bc_src_file *first = load(0);
+	const bc_src_file *again = load(0);
+	TEST_ASSERT(first == again);
+	rc_unref(again);
+
+	/* A changed stamp forces a reload */
+	write_text(g_paths[0], "int changed;\n");
+	const bc_src_file *changed = load(0);
+	TEST_ASSERT(changed != first);
+	const char *text = imm_str_read(src_file_text(changed));
+	TEST_ASSERT(!strcmp(text, "int changed;\n"));
+	rc_unref(first);
+	rc_unref(changed);
+
+	/* Eviction goes by recent use even while callers and the location
+	 * table still hold the files */
+	src_file_cache_trim();
+	src_file_cache_set_max(CACHE_MAX);
+	const bc_src_file *files[FILE_COUNT];
+	for (size_t i = 0; i < CACHE_MAX; i++) {
+		files[i] = load(i);
+		text = imm_str_read(src_file_text(files[i]));
+		TEST_ASSERT(loc_encode(files[i], text) != BC_LOC_NONE);
+	}
+
+	const bc_src_file *touched = load(0);
+	TEST_ASSERT(touched == files[0]);
+	rc_unref(touched);
+
+	files[CACHE_MAX] = load(CACHE_MAX);
+	const bc_src_file *kept = load(0);
+	const bc_src_file *evicted = load(1);
+	TEST_ASSERT(kept == files[0]);
+	TEST_ASSERT(evicted != files[1]);
+	rc_unref(kept);
+	rc_unref(evicted);
+
+	/* Trimming drops every cached file */
+	src_file_cache_trim();
+	const bc_src_file *reloaded = load(CACHE_MAX);
+	TEST_ASSERT(reloaded != files[CACHE_MAX]);
+	rc_unref(reloaded);
+
+	for (size_t i = 0; i < FILE_COUNT; i++) {
+		rc_unref(files[i]);
+		unlink(g_paths[i]);
+	}
+	rmdir(g_dir);
+	src_file_cache_trim();
+	return EXIT_SUCCESS;
+}
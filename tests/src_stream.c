@@ -0,0 +1,172 @@
+#include "imm_str.h"
+#include "rc.h"
+#include "scan.h"
+#include "src_file.h"
+#include "test.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <unistd.h>
+
+/* Configuration Knobs */
+
+#define LINE_COUNT 4000
+#define PIECE_LEN_MAX 4093
+
+/* Every line holds 2, 3 and 4 byte sequences */
+#define LINE_FMT "let caf\xc3\xa9_%u = \"\xe2\x82\xac\xf0\x9f\x98\x80\";\n"
+#define LINE_CHAR_COUNT 3
+
+static char *g_text;
+static size_t g_len;
+
+static void make_text(void)
+{
+	g_text = malloc(LINE_COUNT * 64);
+	TEST_ASSERT(g_text);
+	g_len = 0;
+	for (unsigned i = 0; i < LINE_COUNT; i++) {
+		g_len += (size_t)sprintf(g_text + g_len, LINE_FMT, i);
+	}
+}
+
+static bool is_cont_byte(char c)
+{
+	return ((unsigned char)c & 0xC0) == 0x80;
+}
+
+static size_t count_chars(const char *at, size_t len)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < len; i++) {
+		count += (unsigned char)at[i] >= 0xC0;
+	}
+	return count;
+}
+
+static size_t get_piece_len(size_t index)
+{
+	static const size_t lens[] = {1, 2, 3, 5, 7, 11, 97, 509, PIECE_LEN_MAX};
+	return lens[index % (sizeof(lens) / sizeof(*lens))];
+}
+
+/*
+ * Each piece is written before the read that returns it, so every chunk is
+ * exactly one piece and the odd lengths put boundaries inside lines and
+ * inside multi-byte sequences.
+ */
+static void test_pipe(void)
+{
+	int fds[2];
+	TEST_ASSERT(pipe(fds) == 0);
+	bc_src_stream *stream = src_stream_open_fd("<pipe>", fds[0]);
+	TEST_ASSERT(stream);
+
+	size_t offset = 0;
+	size_t line_splits = 0;
+	size_t char_splits = 0;
+	size_t newlines = 0;
+	size_t chars = 0;
+	for (size_t i = 0; offset < g_len; i++) {
+		size_t len = get_piece_len(i);
+		if (len > g_len - offset) {
+			len = g_len - offset;
+		}
+		TEST_ASSERT(write(fds[1], g_text + offset, len) == (ssize_t)len);
+
+		const char *chunk;
+		size_t chunk_len;
+		TEST_ASSERT(src_stream_next(stream, &chunk, &chunk_len));
+		TEST_ASSERT(chunk_len == len);
+		TEST_ASSERT(!memcmp(chunk, g_text + offset, len));
+
+		size_t text_len;
+		const char *text = src_stream_text(stream, &text_len);
+		TEST_ASSERT(text_len == offset + len);
+		TEST_ASSERT(chunk == text + offset);
+
+		newlines += scan_count_newlines(chunk, chunk + chunk_len);
+		chars += count_chars(chunk, chunk_len);
+		offset += len;
+		if (offset < g_len) {
+			line_splits += chunk[chunk_len - 1] != '\n';
+			char_splits += is_cont_byte(g_text[offset]);
+		}
+	}
+	TEST_ASSERT(line_splits > 0);
+	TEST_ASSERT(char_splits > 0);
+	TEST_ASSERT(newlines == LINE_COUNT);
+	TEST_ASSERT(chars == LINE_COUNT * LINE_CHAR_COUNT);
+
+	close(fds[1]);
+	const char *chunk;
+	size_t chunk_len;
+	TEST_ASSERT(!src_stream_next(stream, &chunk, &chunk_len));
+
+	const bc_src_file *file = src_stream_finish(stream);
+	TEST_ASSERT(file);
+	const bc_imm_str *text = src_file_text(file);
+	TEST_ASSERT(imm_str_len(text) == g_len);
+	TEST_ASSERT(!memcmp(imm_str_read(text), g_text, g_len));
+	TEST_ASSERT(src_file_line_count(file) == LINE_COUNT + 1);
+
+	const char *euro = strstr(imm_str_read(text), "\"\xe2\x82\xac") + 1;
+	size_t line, col;
+	TEST_ASSERT(src_file_get_pos(&line, &col, file, euro));
+	TEST_ASSERT(line == 1);
+	TEST_ASSERT(col == (size_t)(euro - imm_str_read(text)) + 1);
+	rc_unref(file);
+}
+
+static int write_fifo(void *arg)
+{
+	int fd = open(arg, O_WRONLY | O_CLOEXEC);
+	TEST_ASSERT(fd >= 0);
+	for (size_t offset = 0, i = 0; offset < g_len; i++) {
+		size_t len = get_piece_len(i);
+		if (len > g_len - offset) {
+			len = g_len - offset;
+		}
+		TEST_ASSERT(write(fd, g_text + offset, len) == (ssize_t)len);
+		offset += len;
+	}
+	close(fd);
+	return 0;
+}
+
+static void test_fifo(void)
+{
+	char dir[] = "/tmp/bc_src_stream_XXXXXX";
+	TEST_ASSERT(mkdtemp(dir));
+	char path[sizeof(dir) + 8];
+	snprintf(path, sizeof(path), "%s/fifo", dir);
+	TEST_ASSERT(mkfifo(path, 0600) == 0);
+
+	thrd_t writer;
+	TEST_ASSERT(thrd_create(&writer, write_fifo, path) == thrd_success);
+	const bc_src_file *file = src_file_load(path);
+	TEST_ASSERT(thrd_join(writer, NULL) == thrd_success);
+
+	TEST_ASSERT(file);
+	const bc_imm_str *text = src_file_text(file);
+	TEST_ASSERT(imm_str_len(text) == g_len);
+	TEST_ASSERT(!memcmp(imm_str_read(text), g_text, g_len));
+	TEST_ASSERT(src_file_line_count(file) == LINE_COUNT + 1);
+	rc_unref(file);
+
+	unlink(path);
+	rmdir(dir);
+}
+
+int main(void)
+{
+	make_text();
+	test_pipe();
+	test_fifo();
+	free(g_text);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+#ifndef BC_TEST_H
+#define BC_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_ASSERT(cond)                                               \
+	do {                                                                \
+		if (!(cond)) {                                                  \
+			fprintf(                                                    \
+				stderr, "%s:%d: assertion failed: %s\n", __FILE__,      \
+				__LINE__, #cond);                                       \
+			exit(EXIT_FAILURE);                                         \
+		}                                                               \
+	} while (0)
+
+#endif